@@ -0,0 +1,264 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*! \file
+ * micro benchmarks of the AD kernels on synthetic tapes
+ *
+ * each case compiles one constraint and measures the compilation together
+ * with the symbolic analysis (SimStack, HessSimStack::setJac) and the
+ * numeric evaluation up to the hessian (CStack::doAdd, doMull, doUnaryOp, ListCStack::merge). The cases
+ * are
+ *  - wide_sum: sum of n products x_i*x_{i+1}, stresses doAdd and merge
+ *  - deep_product: product of n factors (x_i + 1), stresses doMull
+ *  - trig_chain: n nested sin/cos of x_0*x_1, stresses doUnaryOp
+ *  - conflicts: sum of n products of 8 variables, each variable is
+ *    repeated n/4 times, stresses the conflict handling
+ *
+ * if perf events are available, the instructions per cycle and the cache and
+ * branch misses per evaluation are reported as well
+ *
+ * usage: kernel_bench [--json] [--min-time seconds] [--filter name]
+ */
+#include "../src/model.hpp"
+#include "../src/inner_constraint.hpp"
+#include "../src/perf_counters.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <new>
+
+using namespace MadOpt;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size){
+    allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+class BenchModel: public Model {
+    public:
+        void solve(){}
+};
+
+struct Case {
+    string name;
+    Idx size;
+    //! number of variables
+    Idx nx;
+    std::function<Expr(const vector<Var>&, const Idx&)> build;
+};
+
+struct Result {
+    Idx tape_ops;
+    Idx jac_nnz;
+    Idx hess_nnz;
+    double symbolic_ns_per_op;
+    double eval_ns_per_op;
+    double jac_nnz_per_s;
+    double hess_nnz_per_s;
+    double allocs_per_eval;
+    //! hardware counters of the evaluation, -1 if not available
+    double ipc;
+    double cache_misses_per_eval;
+    double branch_misses_per_eval;
+};
+
+static vector<Case> cases(){
+    vector<Case> result;
+    for (Idx n: {10, 1000, 100000})
+        result.push_back({"wide_sum", n, n + 1,
+            [](const vector<Var>& x, const Idx& n){
+                Expr e;
+                for (Idx i=0; i<n; i++)
+                    e += x[i]*x[i+1];
+                return e;
+            }});
+    for (Idx n: {8, 64, 256})
+        result.push_back({"deep_product", n, n,
+            [](const vector<Var>& x, const Idx& n){
+                Expr e(1);
+                for (Idx i=0; i<n; i++)
+                    e *= x[i] + 1;
+                return e;
+            }});
+    for (Idx n: {10, 100, 1000})
+        result.push_back({"trig_chain", n, 2,
+            [](const vector<Var>& x, const Idx& n){
+                Expr e = x[0]*x[1];
+                for (Idx i=0; i<n; i++)
+                    e = i % 2 == 0 ? sin(e) : cos(e);
+                return e;
+            }});
+    for (Idx n: {100, 10000})
+        result.push_back({"conflicts", n, 8,
+            [](const vector<Var>& x, const Idx& n){
+                Expr e;
+                for (Idx i=0; i<n; i++)
+                    e += x[i % 8]*x[(3*i + 1) % 8];
+                return e;
+            }});
+    return result;
+}
+
+static double seconds(const std::chrono::steady_clock::time_point& start){
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+//! runs f until min_time has passed, returns the seconds per run
+template<class F>
+static double measure(const double& min_time, size_t& runs, F f){
+    f();
+    runs = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+        f();
+        runs++;
+    } while ((elapsed = seconds(start)) < min_time);
+    return elapsed / runs;
+}
+
+static Result run(const Case& c, const double& min_time){
+    BenchModel m;
+    vector<Var> x;
+    for (Idx i=0; i<c.nx; i++)
+        x.push_back(m.addVar(-1, 1, 0.1, ""));
+    Expr expr = c.build(x, c.size);
+    vector<double> point(c.nx);
+    for (Idx i=0; i<c.nx; i++)
+        point[i] = 0.5 + 0.4*std::sin(i);
+
+    SimStack simstack;
+    simstack.setXSize(c.nx);
+    size_t runs;
+    Result r;
+    double symbolic = measure(min_time, runs, [&](){
+            HessPosMap hess_pos_map;
+            InnerConstraint con(expr, 0, 0);
+            con.analyze(simstack);
+            con.mapHess(hess_pos_map);
+        });
+
+    HessPosMap hess_pos_map;
+    InnerConstraint con(expr, 0, 0, hess_pos_map, simstack);
+    CStack cstack;
+    cstack.resize(simstack);
+    cstack.setX(point.data());
+    cstack.setOrder(2);
+    r.tape_ops = con.layout().tape_size;
+    r.jac_nnz = con.getNNZ_Jac();
+    r.hess_nnz = con.getHess().size();
+    vector<double> jac(r.jac_nnz);
+
+    size_t allocs = allocations;
+    double eval = measure(min_time, runs, [&](){
+            con.setEvals(cstack, jac.data(), nullptr);
+        });
+    r.allocs_per_eval = double(allocations - allocs) / (runs + 1);
+
+    PerfCounters counters;
+    r.ipc = r.cache_misses_per_eval = r.branch_misses_per_eval = -1;
+    if (counters.available()){
+        PerfCounts begin = counters.read();
+        measure(min_time, runs, [&](){
+                con.setEvals(cstack, jac.data(), nullptr);
+            });
+        PerfCounts counts = counters.read() - begin;
+        r.ipc = counts.ipc();
+        r.cache_misses_per_eval = double(counts.cache_misses) / (runs + 1);
+        r.branch_misses_per_eval = double(counts.branch_misses) / (runs + 1);
+    }
+    r.symbolic_ns_per_op = 1e9 * symbolic / r.tape_ops;
+    r.eval_ns_per_op = 1e9 * eval / r.tape_ops;
+    r.jac_nnz_per_s = r.jac_nnz / eval;
+    r.hess_nnz_per_s = r.hess_nnz / eval;
+    return r;
+}
+
+int main(int argc, char** argv){
+    bool json = false;
+    double min_time = 0.2;
+    string filter;
+    for (int i=1; i<argc; i++){
+        if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (strcmp(argv[i], "--min-time") == 0 && i+1 < argc)
+            min_time = atof(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && i+1 < argc)
+            filter = argv[++i];
+        else {
+            std::cerr << "usage: " << argv[0]
+                << " [--json] [--min-time seconds] [--filter name]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (json)
+        std::cout << "{\"benchmarks\": [";
+    else
+        printf("%-14s %8s %8s %8s %8s %12s %10s %12s %12s %8s %6s %10s %10s\n",
+                "case", "size", "ops", "jac", "hess", "symb ns/op", "ns/op",
+                "jac nz/s", "hess nz/s", "alloc/ev", "ipc", "miss/ev",
+                "brmiss/ev");
+    bool first = true;
+    auto all = cases();
+    FOREACH(c, all)
+        if (c.name.find(filter) == string::npos)
+            continue;
+        Result r = run(c, min_time);
+        if (json){
+            std::cout << (first ? "" : ",") << "\n  {\"name\": \"" << c.name
+                << "\", \"size\": " << c.size
+                << ", \"tape_ops\": " << r.tape_ops
+                << ", \"jac_nnz\": " << r.jac_nnz
+                << ", \"hess_nnz\": " << r.hess_nnz
+                << ", \"symbolic_ns_per_op\": " << r.symbolic_ns_per_op
+                << ", \"eval_ns_per_op\": " << r.eval_ns_per_op
+                << ", \"jac_nnz_per_s\": " << r.jac_nnz_per_s
+                << ", \"hess_nnz_per_s\": " << r.hess_nnz_per_s
+                << ", \"allocs_per_eval\": " << r.allocs_per_eval
+                << ", \"ipc\": " << r.ipc
+                << ", \"cache_misses_per_eval\": " << r.cache_misses_per_eval
+                << ", \"branch_misses_per_eval\": " << r.branch_misses_per_eval
+                << "}";
+        } else
+            printf("%-14s %8u %8u %8u %8u %12.2f %10.2f %12.4g %12.4g %8.2f %6.2f %10.4g %10.4g\n",
+                    c.name.c_str(), c.size, r.tape_ops, r.jac_nnz, r.hess_nnz,
+                    r.symbolic_ns_per_op, r.eval_ns_per_op, r.jac_nnz_per_s,
+                    r.hess_nnz_per_s, r.allocs_per_eval, r.ipc,
+                    r.cache_misses_per_eval, r.branch_misses_per_eval);
+        first = false;
+    }
+    if (json)
+        std::cout << "\n]}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_BENCH_MODELS_H
+#define MADOPT_BENCH_MODELS_H
+
+/*! \file
+ * scalable model generators of the benchmark corpus, each builds a model
+ * with about n variables
+ */
+#include "../src/model.hpp"
+
+#include <cmath>
+#include <functional>
+
+namespace MadOptBench {
+
+using namespace MadOpt;
+using std::vector;
+
+/*! \brief the chain problem of examples/get_started.cpp and
+ * tests/cpp/TutorialCpp_nlp.cpp
+ * \details min sum (x_i - 1)^2
+ * s.t. (x_{i+1}^2 + 1.5 x_{i+1} - a_i) cos(x_{i+2}) - x_i = 0
+ */
+inline void chain(Model& m, const Idx& n){
+    vector<Var> x(n);
+    for (Idx i=0; i<n; i++)
+        x[i] = m.addVar(-1.5, 0, -0.5, "");
+    m.addConstrs(n-2, [&](const Idx& i, double& lb, double& ub){
+            Param a = m.addParam(double(i+2)/n, "");
+            lb = ub = 0;
+            return (pow(x[i+1], 2) + 1.5*x[i+1] - a)*cos(x[i+2]) - x[i];
+        });
+    Expr obj(0);
+    for (Idx i=0; i<n; i++)
+        obj += pow(x[i] - 1, 2);
+    m.setObj(obj);
+}
+
+/*! \brief pendulum swing down discretised with explicit Euler steps
+ * \details states theta, omega and control u for n/3 steps, min sum h
+ * (theta^2 + 0.1 u^2)
+ */
+inline void optimalControl(Model& m, const Idx& n){
+    const Idx steps = std::max<Idx>(n/3, 2);
+    const double h = 10.0/steps;
+    vector<Var> theta(steps), omega(steps), u(steps);
+    for (Idx k=0; k<steps; k++){
+        bool fixed = k == 0;
+        theta[k] = m.addVar(fixed ? 1 : -INF, fixed ? 1 : INF, 1, "");
+        omega[k] = m.addVar(fixed ? 0 : -INF, fixed ? 0 : INF, 0, "");
+        u[k] = m.addVar(-1, 1, 0, "");
+    }
+    m.addConstrs(steps-1, [&](const Idx& k, double& lb, double& ub){
+            lb = ub = 0;
+            return theta[k+1] - theta[k] - h*omega[k];
+        });
+    m.addConstrs(steps-1, [&](const Idx& k, double& lb, double& ub){
+            lb = ub = 0;
+            return omega[k+1] - omega[k] - h*(u[k] - sin(theta[k]));
+        });
+    Expr obj(0);
+    for (Idx k=0; k<steps; k++)
+        obj += h*(pow(theta[k], 2) + 0.1*pow(u[k], 2));
+    m.setObj(obj);
+}
+
+/*! \brief convex QP with a banded hessian and n/2 sparse covering rows
+ * \details min sum 0.5 x_i^2 + 0.25 x_i x_{i+1} - c_i x_i
+ * s.t. x_i + x_{i+1} + x_{(7i+3) mod n} >= 1
+ */
+inline void sparseQP(Model& m, const Idx& n){
+    vector<Var> x(n);
+    for (Idx i=0; i<n; i++)
+        x[i] = m.addVar(-10, 10, 0, "");
+    m.addConstrs(n/2, [&](const Idx& i, double& lb, double& ub){
+            lb = 1;
+            return x[i] + x[i+1] + x[(7*(size_t)i + 3) % n];
+        });
+    Expr obj(0);
+    for (Idx i=0; i<n; i++){
+        obj += 0.5*pow(x[i], 2) - std::sin(i)*x[i];
+        if (i+1 < n)
+            obj += 0.25*x[i]*x[i+1];
+    }
+    m.setObj(obj);
+}
+
+/*! \brief AC power flow like network of n/2 buses
+ * \details voltage magnitude v and angle theta per bus, lines connect bus i
+ * to i+1 and to i+17, every 10th bus has a generator. The active and
+ * reactive power balance is enforced at every bus, the deviation of v from
+ * 1 is minimized.
+ */
+inline void powerFlow(Model& m, const Idx& n){
+    const Idx buses = std::max<Idx>(n/2, 20);
+    const double g = 1;
+    const double b = -10;
+    vector<Var> v(buses), theta(buses);
+    vector<vector<Idx> > lines(buses);
+    for (Idx i=0; i<buses; i++){
+        v[i] = m.addVar(0.9, 1.1, 1, "");
+        theta[i] = m.addVar(i == 0 ? 0 : -INF, i == 0 ? 0 : INF, 0, "");
+        for (Idx j: {(i+1) % buses, (i+17) % buses}){
+            lines[i].push_back(j);
+            lines[j].push_back(i);
+        }
+    }
+    vector<Var> pg(buses), qg(buses);
+    for (Idx i=0; i<buses; i+=10){
+        pg[i] = m.addVar(0, 10, 0, "");
+        qg[i] = m.addVar(-10, 10, 0, "");
+    }
+    auto flow = [&](const Idx& i, bool active){
+        Expr e(0);
+        FOREACH(j, lines[i])
+            Expr d = theta[i] - theta[j];
+            if (active)
+                e += v[i]*v[j]*(g*cos(d) + b*sin(d));
+            else
+                e += v[i]*v[j]*(g*sin(d) - b*cos(d));
+        }
+        return e;
+    };
+    for (bool active: {true, false})
+        m.addConstrs(buses, [&](const Idx& i, double& lb, double& ub){
+                lb = ub = active ? -0.01 : -0.005;
+                Expr e = -1.0*flow(i, active);
+                if (i % 10 == 0)
+                    e += active ? pg[i] : qg[i];
+                return e;
+            });
+    Expr obj(0);
+    for (Idx i=0; i<buses; i++)
+        obj += pow(v[i] - 1, 2);
+    for (Idx i=0; i<buses; i+=10)
+        obj += 0.1*pg[i];
+    m.setObj(obj);
+}
+
+/*! \brief facility location with quadratic transport costs for Bonmin
+ * \details sqrt(n) facilities with binary y_j, each of the customers is
+ * served by the facilities with the shares x_ij, x_ij <= y_j
+ */
+inline void facilityLocation(Model& m, const Idx& n){
+    const Idx facilities = std::max<Idx>(std::sqrt(n)/2, 2);
+    const Idx customers = std::max<Idx>(n/facilities, 2);
+    vector<Var> y(facilities);
+    for (Idx j=0; j<facilities; j++)
+        y[j] = m.addBVar(1, "");
+    vector<vector<Var> > x(customers, vector<Var>(facilities));
+    Expr obj(0);
+    for (Idx j=0; j<facilities; j++)
+        obj += (10.0 + j % 3)*y[j];
+    for (Idx i=0; i<customers; i++){
+        Expr served(0);
+        for (Idx j=0; j<facilities; j++){
+            x[i][j] = m.addVar(0, 1, 1.0/facilities, "");
+            served += x[i][j];
+            obj += (1 + std::fabs(std::sin(i*facilities + j)))*pow(x[i][j], 2);
+            m.addConstr(x[i][j] - y[j], 0);
+        }
+        m.addEqConstr(served, 1);
+    }
+    m.setObj(obj);
+}
+
+struct Generator {
+    const char* name;
+    std::function<void(Model&, const Idx&)> build;
+    //! true if the model has integer variables
+    bool minlp;
+};
+
+inline vector<Generator> generators(){
+    return {
+        {"chain", chain, false},
+        {"optimal_control", optimalControl, false},
+        {"sparse_qp", sparseQP, false},
+        {"power_flow", powerFlow, false},
+        {"facility_location", facilityLocation, true}
+    };
+}
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
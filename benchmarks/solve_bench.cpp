@@ -0,0 +1,378 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*! \file
+ * end to end benchmark of the model corpus in models.hpp
+ *
+ * every generator runs for 10^3 up to --max-size variables, each in a
+ * process of its own to measure its peak RSS. Recorded are the build time
+ * including the symbolic analysis, the time per call of each callback at
+ * the initial point, the solve time, the iterations and the peak RSS. If
+ * perf events are available, the cycles, instructions per cycle, cache and
+ * branch misses per call of the forward, jacobian and hessian evaluation
+ * are recorded as well. The results are compared against a baseline written by --save-baseline,
+ * regressions beyond --tolerance are reported and fail the run.
+ *
+ * usage: solve_bench [--max-size n] [--filter name] [--no-solve]
+ *     [--timelimit s] [--json] [--baseline file] [--save-baseline file]
+ *     [--tolerance t]
+ */
+#include "models.hpp"
+#include "../src/ipopt_model.hpp"
+#ifdef MADOPT_BENCH_BONMIN
+#include "../src/bonmin_model.hpp"
+#endif
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace MadOptBench;
+
+//! a result as flat json object
+typedef std::map<string, string> Record;
+
+struct Options {
+    Idx max_size;
+    string filter;
+    bool solve;
+    double timelimit;
+    bool json;
+    string baseline;
+    string save_baseline;
+    double tolerance;
+};
+
+//! metrics compared against the baseline, lower is better
+static const vector<string> metrics = {"build_s", "eval_f_s", "eval_grad_f_s",
+    "eval_g_s", "eval_jac_g_s", "eval_h_s", "solve_s", "iterations",
+    "peak_rss_kb"};
+
+static double seconds(const std::chrono::steady_clock::time_point& start){
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+//! runs f repeatedly for at least 0.1 seconds, returns the seconds per call
+template<class F>
+static double perCall(F f){
+    size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+        f();
+        calls++;
+    } while ((elapsed = seconds(start)) < 0.1);
+    return elapsed / calls;
+}
+
+static string number(const double& v){
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", v);
+    return buf;
+}
+
+static string toJson(const Record& r){
+    std::ostringstream out;
+    out << "{";
+    bool first = true;
+    FOREACH(it, r)
+        out << (first ? "" : ", ") << "\"" << it.first << "\": ";
+        if (it.first == "name" || it.first == "error")
+            out << "\"" << it.second << "\"";
+        else
+            out << it.second;
+        first = false;
+    }
+    out << "}";
+    return out.str();
+}
+
+//! parses a flat json object without escapes as written by toJson()
+static Record fromJson(const string& line){
+    Record r;
+    size_t pos = 0;
+    while ((pos = line.find('"', pos)) != string::npos){
+        size_t end = line.find('"', pos+1);
+        size_t colon = line.find(':', end);
+        if (end == string::npos || colon == string::npos)
+            break;
+        string key = line.substr(pos+1, end-pos-1);
+        size_t begin = line.find_first_not_of(" ", colon+1);
+        if (begin == string::npos)
+            break;
+        if (line[begin] == '"'){
+            end = line.find('"', begin+1);
+            r[key] = line.substr(begin+1, end-begin-1);
+        } else {
+            end = line.find_first_of(",}", begin);
+            r[key] = line.substr(begin, end-begin);
+        }
+        pos = end + 1;
+    }
+    return r;
+}
+
+static Model* makeModel(const Generator& gen){
+#ifdef MADOPT_BENCH_BONMIN
+    if (gen.minlp)
+        return new BonminModel();
+#endif
+    return new IpoptModel();
+}
+
+static Record runCase(const Generator& gen, const Idx& n, const Options& opt){
+    Record r;
+    std::unique_ptr<Model> m(makeModel(gen));
+    auto start = std::chrono::steady_clock::now();
+    gen.build(*m, n);
+    m->finalizeConstraints();
+    r["build_s"] = number(seconds(start));
+    r["nx"] = number(m->nx());
+    r["ng"] = number(m->ng());
+    r["nnz_jac"] = number(m->getNNZ_Jac());
+    r["nnz_hess"] = number(m->getNNZ_Hess());
+
+    vector<double> x(m->nx());
+    vector<double> grad(m->nx());
+    vector<double> g(m->ng());
+    vector<double> lambda(m->ng(), 1);
+    vector<double> jac(m->getNNZ_Jac());
+    vector<double> hess(m->getNNZ_Hess());
+    m->getInits(x.data());
+    double f;
+    r["eval_f_s"] = number(perCall([&](){ m->eval_f(x.data(), true, f); }));
+    r["eval_grad_f_s"] = number(perCall([&](){
+                m->eval_grad_f(x.data(), true, grad.data()); }));
+    r["eval_g_s"] = number(perCall([&](){ m->eval_g(x.data(), true, g.data()); }));
+    r["eval_jac_g_s"] = number(perCall([&](){
+                m->eval_jac_g(x.data(), true, jac.data()); }));
+    r["eval_h_s"] = number(perCall([&](){
+                m->eval_h(x.data(), true, hess.data(), 1, lambda.data()); }));
+
+    // separate runs, reading the counters costs system calls
+    m->collect_stats = true;
+    perCall([&](){ m->setEvals(x.data()); });
+    perCall([&](){ m->eval_jac_g(x.data(), true, jac.data()); });
+    perCall([&](){ m->eval_h(x.data(), true, hess.data(), 1, lambda.data()); });
+    const ModelStats& stats = m->stats();
+    r["hardware_counters"] = number(stats.hardware_counters);
+    if (stats.hardware_counters)
+        for (int i=0; i<ModelStats::NOF_PHASES; i++){
+            auto phase = ModelStats::Phase(i);
+            const PhaseStats& p = stats.phases[phase];
+            string name = ModelStats::name(phase);
+            double calls = std::max<Idx>(p.calls, 1);
+            r[name + "_cycles"] = number(p.counters.cycles/calls);
+            r[name + "_ipc"] = number(p.counters.ipc());
+            r[name + "_cache_misses"] = number(p.counters.cache_misses/calls);
+            r[name + "_branch_misses"] = number(p.counters.branch_misses/calls);
+        }
+    m->collect_stats = false;
+
+    if (opt.solve){
+        m->timelimit = opt.timelimit;
+        start = std::chrono::steady_clock::now();
+        m->solve();
+        r["solve_s"] = number(seconds(start));
+        r["status"] = number(m->status());
+        auto ipopt = dynamic_cast<IpoptModel*>(m.get());
+        if (ipopt != nullptr)
+            r["iterations"] = number(ipopt->nofIterations());
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    r["peak_rss_kb"] = number(usage.ru_maxrss);
+    return r;
+}
+
+//! runs the case in a child process, such that its peak RSS is its own
+static Record runIsolated(const Generator& gen, const Idx& n, const Options& opt){
+    int fds[2];
+    if (pipe(fds) != 0)
+        throw std::runtime_error("pipe failed");
+    pid_t pid = fork();
+    if (pid == 0){
+        close(fds[0]);
+        Record r;
+        try {
+            r = runCase(gen, n, opt);
+        } catch (std::exception& e){
+            r["error"] = e.what();
+        }
+        string line = toJson(r) + "\n";
+        ssize_t written = write(fds[1], line.data(), line.size());
+        _exit(written == (ssize_t) line.size() ? 0 : 1);
+    }
+    close(fds[1]);
+    string line;
+    char buf[4096];
+    ssize_t k;
+    while ((k = read(fds[0], buf, sizeof(buf))) > 0)
+        line.append(buf, k);
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    Record r = fromJson(line);
+    if (line.empty())
+        r["error"] = "benchmark process failed";
+    r["name"] = gen.name;
+    r["size"] = number(n);
+    return r;
+}
+
+static string key(const Record& r){
+    return r.at("name") + "/" + r.at("size");
+}
+
+//! prints the regressions of r against base, returns their number
+static int compare(const Record& r, const Record& base, const double& tolerance){
+    int regressions = 0;
+    FOREACH(metric, metrics)
+        auto now = r.find(metric);
+        auto before = base.find(metric);
+        if (now == r.end() || before == base.end())
+            continue;
+        double v = atof(now->second.c_str());
+        double b = atof(before->second.c_str());
+        // timings below a microsecond are noise
+        double slack = metric.find("_s") != string::npos ? 1e-6 : 0;
+        if (v > b*(1 + tolerance) + slack){
+            std::cerr << "regression " << key(r) << " " << metric << ": "
+                << now->second << " baseline " << before->second << std::endl;
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+static void usage(const char* name){
+    std::cerr << "usage: " << name << " [--max-size n] [--filter name]"
+        << " [--no-solve] [--timelimit s] [--json] [--baseline file]"
+        << " [--save-baseline file] [--tolerance t]" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char** argv){
+    Options opt = {100000, "", true, 600, false, "", "", 0.25};
+    for (int i=1; i<argc; i++){
+        string arg = argv[i];
+        bool has_value = i+1 < argc;
+        if (arg == "--max-size" && has_value)
+            opt.max_size = atof(argv[++i]);
+        else if (arg == "--filter" && has_value)
+            opt.filter = argv[++i];
+        else if (arg == "--no-solve")
+            opt.solve = false;
+        else if (arg == "--timelimit" && has_value)
+            opt.timelimit = atof(argv[++i]);
+        else if (arg == "--json")
+            opt.json = true;
+        else if (arg == "--baseline" && has_value)
+            opt.baseline = argv[++i];
+        else if (arg == "--save-baseline" && has_value)
+            opt.save_baseline = argv[++i];
+        else if (arg == "--tolerance" && has_value)
+            opt.tolerance = atof(argv[++i]);
+        else
+            usage(argv[0]);
+    }
+
+    std::map<string, Record> baseline;
+    if (not opt.baseline.empty()){
+        std::ifstream in(opt.baseline);
+        if (not in){
+            std::cerr << "cannot read " << opt.baseline << std::endl;
+            return 1;
+        }
+        string line;
+        while (std::getline(in, line))
+            if (not line.empty()){
+                Record r = fromJson(line);
+                baseline[key(r)] = r;
+            }
+    }
+
+    if (not opt.json)
+        printf("%-18s %9s %9s %9s %10s %10s %10s %10s %10s %9s %6s %9s\n",
+                "model", "nx", "ng", "build s", "f us", "grad us", "g us",
+                "jac us", "h us", "solve s", "iters", "rss MB");
+    vector<Record> results;
+    int regressions = 0;
+    bool hardware_counters = false;
+    vector<Generator> corpus = generators();
+    FOREACH(gen, corpus)
+        if (string(gen.name).find(opt.filter) == string::npos)
+            continue;
+#ifndef MADOPT_BENCH_BONMIN
+        if (gen.minlp)
+            continue;
+#endif
+        // the MINLPs are solved by branch and bound, keep them small
+        Idx max_size = gen.minlp ? std::min<Idx>(opt.max_size, 10000)
+            : opt.max_size;
+        for (Idx n=1000; n<=max_size; n*=10){
+            Record r = runIsolated(gen, n, opt);
+            results.push_back(r);
+            auto get = [&](const string& k, const double& scale){
+                return r.count(k) ? atof(r[k].c_str())*scale : -1;
+            };
+            if (opt.json)
+                std::cout << toJson(r) << std::endl;
+            else if (r.count("error"))
+                printf("%-18s %9u error: %s\n", gen.name, n, r["error"].c_str());
+            else
+                printf("%-18s %9.0f %9.0f %9.3f %10.1f %10.1f %10.1f %10.1f %10.1f %9.3f %6.0f %9.1f\n",
+                        gen.name, get("nx", 1), get("ng", 1), get("build_s", 1),
+                        get("eval_f_s", 1e6), get("eval_grad_f_s", 1e6),
+                        get("eval_g_s", 1e6), get("eval_jac_g_s", 1e6),
+                        get("eval_h_s", 1e6), get("solve_s", 1),
+                        get("iterations", 1), get("peak_rss_kb", 1e-3));
+            hardware_counters = hardware_counters || get("hardware_counters", 1) > 0;
+            if (not opt.json && get("hardware_counters", 1) > 0)
+                for (int i=0; i<ModelStats::NOF_PHASES; i++){
+                    string name = ModelStats::name(ModelStats::Phase(i));
+                    printf("%-18s %9s %-8s %10.4g cycles %5.2f ipc %10.4g cache misses %10.4g branch misses per call\n",
+                            "", "", name.c_str(), get(name + "_cycles", 1),
+                            get(name + "_ipc", 1), get(name + "_cache_misses", 1),
+                            get(name + "_branch_misses", 1));
+                }
+            fflush(stdout);
+            auto base = baseline.find(key(r));
+            if (base != baseline.end())
+                regressions += compare(r, base->second, opt.tolerance);
+        }
+    }
+
+    if (not opt.save_baseline.empty()){
+        std::ofstream out(opt.save_baseline);
+        FOREACH(r, results)
+            out << toJson(r) << "\n";
+        }
+    }
+    if (not hardware_counters && not results.empty())
+        std::cerr << "perf events are not available, timing only" << std::endl;
+    if (not baseline.empty())
+        std::cerr << regressions << " regressions" << std::endl;
+    return regressions > 0 ? 2 : 0;
+}
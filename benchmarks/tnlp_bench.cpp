@@ -0,0 +1,220 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*! \file
+ * abstraction overhead of madopt against the hand written Ipopt TNLP of
+ * the chain problem in tests/cpp/TutorialCpp_nlp.cpp
+ *
+ * both are evaluated at the same initial point and multipliers for the
+ * same number of variables. Reported is the time per call of each callback
+ * and the ratio madopt / TNLP. Before timing, the values of both are
+ * compared, the benchmark fails if they differ.
+ *
+ * usage: tnlp_bench [--sizes n1,n2,...] [--min-time seconds] [--json]
+ */
+#include "models.hpp"
+#include "../src/ipopt_model.hpp"
+#include "../tests/cpp/TutorialCpp_nlp.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace MadOptBench;
+
+typedef std::map<std::pair<int, int>, double> Sparse;
+
+static double min_time = 0.2;
+
+//! runs f repeatedly for at least min_time seconds, returns the seconds per call
+template<class F>
+static double perCall(F f){
+    size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+        f();
+        calls++;
+        elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_time);
+    return elapsed / calls;
+}
+
+//! sums the values per entry, the hessian entries are mapped to the upper triangle
+static Sparse sparse(const vector<int>& rows, const vector<int>& cols,
+        const vector<double>& values, bool symmetric){
+    Sparse s;
+    for (size_t k=0; k<values.size(); k++){
+        int i = rows[k];
+        int j = cols[k];
+        if (symmetric and i > j)
+            std::swap(i, j);
+        s[std::make_pair(i, j)] += values[k];
+    }
+    return s;
+}
+
+static double maxDiff(const Sparse& a, const Sparse& b){
+    double diff = 0;
+    FOREACH(it, a)
+        auto other = b.find(it.first);
+        diff = std::max(diff, std::abs(it.second -
+                    (other == b.end() ? 0 : other->second)));
+    }
+    FOREACH(it, b)
+        if (a.find(it.first) == a.end())
+            diff = std::max(diff, std::abs(it.second));
+    }
+    return diff;
+}
+
+static Idx run(const Idx& n, bool json){
+    vector<double> a(n-2);
+    for (Idx i=0; i<n-2; i++)
+        a[i] = double(i+2)/n;
+    Ipopt::SmartPtr<TutorialCpp_NLP> tnlp = new TutorialCpp_NLP(n, a.data());
+    MadOpt::IpoptModel m;
+    chain(m, n);
+    m.finalizeConstraints();
+
+    int tn, tm, tnnz_jac, tnnz_hess;
+    Ipopt::TNLP::IndexStyleEnum style;
+    tnlp->get_nlp_info(tn, tm, tnnz_jac, tnnz_hess, style);
+    if ((Idx) tn != m.nx() or (Idx) tm != m.ng()){
+        std::cerr << "chain " << n << ": dimensions differ" << std::endl;
+        return 1;
+    }
+
+    vector<double> x(n);
+    m.getInits(x.data());
+    vector<double> lambda(tm, 1);
+
+    // madopt
+    vector<double> grad(n), g(tm);
+    vector<double> jac(m.getNNZ_Jac()), hess(m.getNNZ_Hess());
+    vector<int> jac_rows(jac.size()), jac_cols(jac.size());
+    vector<int> hess_rows(hess.size()), hess_cols(hess.size());
+    m.getNZ_Jac(jac_rows.data(), jac_cols.data());
+    m.getNZ_Hess(hess_rows.data(), hess_cols.data());
+    double f;
+
+    // TNLP
+    vector<double> tgrad(n), tg(tm), tjac(tnnz_jac), thess(tnnz_hess);
+    vector<int> tjac_rows(tnnz_jac), tjac_cols(tnnz_jac);
+    vector<int> thess_rows(tnnz_hess), thess_cols(tnnz_hess);
+    tnlp->eval_jac_g(tn, x.data(), true, tm, tnnz_jac, tjac_rows.data(),
+            tjac_cols.data(), nullptr);
+    tnlp->eval_h(tn, x.data(), true, 1, tm, lambda.data(), true, tnnz_hess,
+            thess_rows.data(), thess_cols.data(), nullptr);
+    double tf;
+
+    auto madopt_f = [&](){ m.eval_f(x.data(), true, f); };
+    auto madopt_grad_f = [&](){ m.eval_grad_f(x.data(), true, grad.data()); };
+    auto madopt_g = [&](){ m.eval_g(x.data(), true, g.data()); };
+    auto madopt_jac_g = [&](){ m.eval_jac_g(x.data(), true, jac.data()); };
+    auto madopt_h = [&](){
+        m.eval_h(x.data(), true, hess.data(), 1, lambda.data()); };
+    auto tnlp_f = [&](){ tnlp->eval_f(tn, x.data(), true, tf); };
+    auto tnlp_grad_f = [&](){ tnlp->eval_grad_f(tn, x.data(), true, tgrad.data()); };
+    auto tnlp_g = [&](){ tnlp->eval_g(tn, x.data(), true, tm, tg.data()); };
+    auto tnlp_jac_g = [&](){ tnlp->eval_jac_g(tn, x.data(), true, tm,
+            tnnz_jac, nullptr, nullptr, tjac.data()); };
+    auto tnlp_h = [&](){ tnlp->eval_h(tn, x.data(), true, 1, tm,
+            lambda.data(), true, tnnz_hess, nullptr, nullptr, thess.data()); };
+
+    madopt_f(); madopt_grad_f(); madopt_g(); madopt_jac_g(); madopt_h();
+    tnlp_f(); tnlp_grad_f(); tnlp_g(); tnlp_jac_g(); tnlp_h();
+    double diff = std::abs(f - tf);
+    for (Idx i=0; i<n; i++)
+        diff = std::max(diff, std::abs(grad[i] - tgrad[i]));
+    for (int j=0; j<tm; j++)
+        diff = std::max(diff, std::abs(g[j] - tg[j]));
+    diff = std::max(diff, maxDiff(sparse(jac_rows, jac_cols, jac, false),
+                sparse(tjac_rows, tjac_cols, tjac, false)));
+    diff = std::max(diff, maxDiff(sparse(hess_rows, hess_cols, hess, true),
+                sparse(thess_rows, thess_cols, thess, true)));
+    if (diff > 1e-9){
+        std::cerr << "chain " << n << ": madopt and TNLP differ by " << diff
+            << std::endl;
+        return 1;
+    }
+
+    struct Callback {
+        const char* name;
+        std::function<void()> madopt;
+        std::function<void()> tnlp;
+    };
+    vector<Callback> callbacks = {
+        {"eval_f", madopt_f, tnlp_f},
+        {"eval_grad_f", madopt_grad_f, tnlp_grad_f},
+        {"eval_g", madopt_g, tnlp_g},
+        {"eval_jac_g", madopt_jac_g, tnlp_jac_g},
+        {"eval_h", madopt_h, tnlp_h}
+    };
+    FOREACH(cb, callbacks)
+        double t_madopt = perCall(cb.madopt);
+        double t_tnlp = perCall(cb.tnlp);
+        if (json)
+            printf("{\"n\": %u, \"callback\": \"%s\", \"madopt_s\": %.6g, "
+                    "\"tnlp_s\": %.6g, \"ratio\": %.4g}\n", n, cb.name,
+                    t_madopt, t_tnlp, t_madopt/t_tnlp);
+        else
+            printf("%10u %-12s %12.1f %12.1f %8.2f\n", n, cb.name,
+                    t_madopt*1e6, t_tnlp*1e6, t_madopt/t_tnlp);
+        fflush(stdout);
+    }
+    return 0;
+}
+
+static void usage(const char* name){
+    std::cerr << "usage: " << name
+        << " [--sizes n1,n2,...] [--min-time seconds] [--json]" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char** argv){
+    vector<Idx> sizes = {1000, 10000, 100000, 1000000};
+    bool json = false;
+    for (int i=1; i<argc; i++){
+        string arg = argv[i];
+        if (arg == "--sizes" and i+1 < argc){
+            sizes.clear();
+            std::istringstream in(argv[++i]);
+            string size;
+            while (std::getline(in, size, ','))
+                sizes.push_back(atof(size.c_str()));
+        } else if (arg == "--min-time" and i+1 < argc)
+            min_time = atof(argv[++i]);
+        else if (arg == "--json")
+            json = true;
+        else
+            usage(argv[0]);
+    }
+    if (not json)
+        printf("%10s %-12s %12s %12s %8s\n", "n", "callback", "madopt us",
+                "TNLP us", "ratio");
+    Idx failed = 0;
+    FOREACH(n, sizes)
+        if (n < 3)
+            usage(argv[0]);
+        failed += run(n, json);
+    }
+    return failed > 0 ? 1 : 0;
+}
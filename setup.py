@@ -6,7 +6,7 @@ build = "build/"
 
 sources=[ 'src/madopt.pyx' ]
 libs = ["libmadopt.a", "libmadopt_ipopt.a", "libmadopt_bonmin.a" ]
-dependencies = ["ipopt", "bonmin"]
+dependencies = ["ipopt", "bonmin", "pthread"]
 
 libs = [build + x for x in libs]
 
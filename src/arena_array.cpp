@@ -0,0 +1,92 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "arena_array.hpp"
+#include "exceptions.hpp"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace MadOpt {
+
+static char* mapFile(const int& fd, const size_t& bytes){
+    void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+        throw MadOptError("cannot map arena file");
+    // constraints are evaluated in the order they are stored
+    madvise(data, bytes, MADV_SEQUENTIAL);
+    return static_cast<char*>(data);
+}
+
+ArenaBuffer::~ArenaBuffer(){
+    if (fileBacked()){
+        if (_data != nullptr)
+            munmap(_data, _capacity);
+        close(fd);
+    } else {
+        free(_data);
+    }
+}
+
+void ArenaBuffer::reallocate(const size_t& bytes){
+    if (not fileBacked()){
+        char* data = static_cast<char*>(realloc(_data, bytes));
+        if (data == nullptr && bytes > 0)
+            throw std::bad_alloc();
+        _data = data;
+        _capacity = bytes;
+        return;
+    }
+    // the file keeps the content while it is remapped
+    if (ftruncate(fd, bytes) != 0)
+        throw MadOptError("cannot grow arena file");
+    char* data = mapFile(fd, bytes);
+    munmap(_data, _capacity);
+    _data = data;
+    _capacity = bytes;
+}
+
+void ArenaBuffer::mapToFile(const string& dir, const size_t& used){
+    if (fileBacked())
+        return;
+    string path = dir + "/madopt-arena-XXXXXX";
+    int file = mkstemp(&path[0]);
+    if (file < 0)
+        throw MadOptError("cannot create arena file in " + dir);
+    // the file is only reachable through fd and vanishes with it
+    unlink(path.c_str());
+    size_t bytes = std::max<size_t>(_capacity, sysconf(_SC_PAGESIZE));
+    if (ftruncate(file, bytes) != 0){
+        close(file);
+        throw MadOptError("cannot grow arena file in " + dir);
+    }
+    char* data;
+    try {
+        data = mapFile(file, bytes);
+    } catch (...) {
+        close(file);
+        throw;
+    }
+    if (used > 0)
+        memcpy(data, _data, used);
+    free(_data);
+    _data = data;
+    _capacity = bytes;
+    fd = file;
+}
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_ARENA_ARRAY_H
+#define MADOPT_ARENA_ARRAY_H
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include "common.hpp"
+
+namespace MadOpt {
+
+/*! \brief untyped memory of an ArenaArray, on the heap or in a file
+ * \details a file backed buffer is a shared mapping of an unlinked file,
+ * hence the operating system can write its pages back and drop them when
+ * memory gets short
+ */
+class ArenaBuffer {
+    public:
+        ArenaBuffer(): _data(nullptr), _capacity(0), fd(-1){}
+
+        ~ArenaBuffer();
+
+        ArenaBuffer(const ArenaBuffer&) = delete;
+
+        char* data()const { return _data; }
+
+        size_t capacity()const { return _capacity; }
+
+        bool fileBacked()const { return fd >= 0; }
+
+        void swap(ArenaBuffer& other){
+            std::swap(_data, other._data);
+            std::swap(_capacity, other._capacity);
+            std::swap(fd, other.fd);
+        }
+
+        //! resizes the buffer to bytes, the content is kept up to the
+        //smaller size
+        void reallocate(const size_t& bytes);
+
+        //! moves the first used bytes into a new file in dir, throws if
+        //this fails, nothing happens if the buffer is file backed already
+        void mapToFile(const string& dir, const size_t& used);
+
+    private:
+        char* _data;
+        size_t _capacity;
+        int fd;
+};
+
+//! growing array of trivially copyable values in an ArenaBuffer
+template<class T>
+class ArenaArray {
+    public:
+        ArenaArray(): _size(0){}
+
+        size_t size()const { return _size; }
+
+        size_t capacity()const { return buffer.capacity() / sizeof(T); }
+
+        //! bytes allocated, on the heap or in the file
+        size_t memory()const { return buffer.capacity(); }
+
+        T* data(){ return reinterpret_cast<T*>(buffer.data()); }
+
+        const T* data()const { return reinterpret_cast<const T*>(buffer.data()); }
+
+        T* begin(){ return data(); }
+
+        const T* begin()const { return data(); }
+
+        T* end(){ return data() + _size; }
+
+        const T* end()const { return data() + _size; }
+
+        T& operator[](const size_t& i){ return data()[i]; }
+
+        const T& operator[](const size_t& i)const { return data()[i]; }
+
+        void reserve(const size_t& n){
+            if (n > capacity())
+                buffer.reallocate(n*sizeof(T));
+        }
+
+        void push_back(const T& v){
+            grow(_size + 1);
+            data()[_size++] = v;
+        }
+
+        template<class It>
+        void append(It first, It last){
+            size_t n = std::distance(first, last);
+            grow(_size + n);
+            std::copy(first, last, end());
+            _size += n;
+        }
+
+        //! new values are zero initialized
+        void resize(const size_t& n){
+            grow(n);
+            if (n > _size)
+                std::fill(end(), data() + n, T());
+            _size = n;
+        }
+
+        void assign(const T* first, const T* last){
+            _size = 0;
+            append(first, last);
+        }
+
+        void clear(){ _size = 0; }
+
+        void swap(ArenaArray& other){
+            buffer.swap(other.buffer);
+            std::swap(_size, other._size);
+        }
+
+        bool fileBacked()const { return buffer.fileBacked(); }
+
+        //! \sa ArenaBuffer::mapToFile()
+        void mapToFile(const string& dir){
+            buffer.mapToFile(dir, _size*sizeof(T));
+        }
+
+    private:
+        ArenaBuffer buffer;
+        size_t _size;
+
+        void grow(const size_t& n){
+            if (n > capacity())
+                reserve(std::max(n, 2*capacity()));
+        }
+};
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -108,6 +108,10 @@ class Array {
             iter=0;
         }
 
+        void skip(const Idx& nof){
+            iter += nof;
+        }
+
         T& next(){
             return data[iter++];
         }
@@ -124,6 +128,10 @@ class Array {
             data.resize(new_size);
         }
 
+        size_t memory()const {
+            return MadOpt::memory(data);
+        }
+
         std::string str()const {
             std::string res;
             for (Idx i=0; i<data_end; i++){
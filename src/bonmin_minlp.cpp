@@ -17,6 +17,7 @@
 #include "bonmin_model.hpp"
 #include "solution.hpp"
 #include "logger.hpp"
+#include "timeline.hpp"
 
 using namespace MadOpt;
 
@@ -33,7 +34,7 @@ bool BonminUserClass::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
 }
 
 bool BonminUserClass::get_variables_types(Index n, Bonmin::TMINLP::VariableType* var_types){
-    auto vars = solver->getVars();
+    const auto& vars = solver->getVars();
     for (Idx i=0; i<solver->nx(); i++){
         VarType vt = vars[i]->getType();
         if (vt == VarType::CONTINUOUS)
@@ -112,6 +113,8 @@ bool BonminUserClass::get_starting_point(Index n, bool init_x, Number* x,
 bool BonminUserClass::eval_f(Index n, const Number* x, bool new_x, Number& obj_value){
     ASSERT(n >= 0); 
     ASSERT((unsigned int)n==solver->nx());
+    CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_F), new_x);
+    TIMELINE_SCOPE("eval_f");
     solver->eval_f(x, new_x, obj_value);
     return true;
 }
@@ -119,6 +122,8 @@ bool BonminUserClass::eval_f(Index n, const Number* x, bool new_x, Number& obj_v
 bool BonminUserClass::eval_grad_f(Index n, const Number* x, bool new_x, Number* grad_f){
     ASSERT(n >= 0); 
     ASSERT((unsigned int)n==solver->nx());
+    CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_GRAD_F), new_x);
+    TIMELINE_SCOPE("eval_grad_f");
     solver->eval_grad_f(x, new_x, grad_f);
     return true;
 }
@@ -126,6 +131,8 @@ bool BonminUserClass::eval_grad_f(Index n, const Number* x, bool new_x, Number*
 bool BonminUserClass::eval_g(Index n, const Number* x, bool new_x, Index m, Number* g){
     ASSERT(n >= 0); 
     ASSERT((unsigned int)n==solver->nx());
+    CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_G), new_x);
+    TIMELINE_SCOPE("eval_g");
     solver->eval_g(x, new_x, g);
     return true;
 }
@@ -140,6 +147,9 @@ bool BonminUserClass::eval_jac_g(Index n, const Number* x, bool new_x,
     if (values == NULL){
         solver->getNZ_Jac(iRow, jCol);
     } else {
+        CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_JAC_G),
+                new_x);
+        TIMELINE_SCOPE("eval_jac_g");
         solver->eval_jac_g(x, new_x, values);
     }
     return true;
@@ -156,6 +166,9 @@ bool BonminUserClass::eval_h(Index n, const Number* x, bool new_x,
     if (values == NULL){
         solver->getNZ_Hess(iRow, jCol);
     } else {
+        CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_H),
+                new_x);
+        TIMELINE_SCOPE("eval_h");
         solver->eval_h(x, new_x, values, obj_factor, lambda);
     }
     return true;
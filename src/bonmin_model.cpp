@@ -15,6 +15,7 @@
  */
 #include "bonmin_model.hpp"
 #include "bonmin_minlp.hpp"
+#include "timeline.hpp"
 
 #include "common.hpp"
 
@@ -47,6 +48,7 @@ BonminModel::~BonminModel(){
 }
 
 void BonminModel::solve(){
+    TIMELINE_SCOPE("solve");
     if (timelimit >= 0)
         setNumericOption("bonmin.time_limit", timelimit);
 
@@ -57,6 +59,10 @@ void BonminModel::solve(){
         setStringOption("sb", "yes");
     }
 
+    auto start = std::chrono::steady_clock::now();
+    finalizeConstraints();
+    clearEvalCache();
+
     try {
         impl->Bapp->initialize(GetRawPtr(impl->bonmin_callback));
         Bonmin::Bab bb;
@@ -73,6 +79,10 @@ void BonminModel::solve(){
     // OsiTMINLPInterface::SimpleError &E
     // CoinError &E
 
+    if (collect_stats)
+        model_stats.solve_time += std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
     model_changed = false;
 }
 
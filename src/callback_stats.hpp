@@ -0,0 +1,188 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_CALLBACK_STATS_H
+#define MADOPT_CALLBACK_STATS_H
+
+#include <chrono>
+#include "common.hpp"
+#include "perf_counters.hpp"
+
+namespace MadOpt {
+
+//! call statistics of one solver callback
+struct CallbackStats {
+    CallbackStats(): calls(0), new_x(0), total_time(0), max_time(0){}
+
+    //! number of calls
+    Idx calls;
+    //! number of calls with a new point x
+    Idx new_x;
+    //! cumulative wall time in seconds
+    double total_time;
+    //! longest call in seconds
+    double max_time;
+
+    //! fraction of the calls that reused the current point
+    double hitRate() const {
+        return calls == 0 ? 0 : 1 - double(new_x)/calls;
+    }
+
+    void record(const double& seconds, bool is_new_x){
+        calls++;
+        if (is_new_x)
+            new_x++;
+        total_time += seconds;
+        if (seconds > max_time)
+            max_time = seconds;
+    }
+};
+
+//! wall time and hardware counters of one evaluation phase of the model
+struct PhaseStats {
+    PhaseStats(): calls(0), total_time(0){}
+
+    //! number of calls
+    Idx calls;
+    //! cumulative wall time in seconds
+    double total_time;
+    //! cumulative counts, zero if the counters are not available
+    PerfCounts counters;
+
+    void record(const double& seconds, const PerfCounts& counts){
+        calls++;
+        total_time += seconds;
+        counters += counts;
+    }
+};
+
+/*! \brief call statistics of the solver callbacks, \sa Model::stats()
+ * \details the time spent in the solver itself, e.g. in the linear algebra,
+ * is solve_time minus callbackTime()
+ */
+struct ModelStats {
+    enum Callback {EVAL_F, EVAL_GRAD_F, EVAL_G, EVAL_JAC_G, EVAL_H,
+        NOF_CALLBACKS};
+
+    /*! evaluation phases of the model, FORWARD are the values of
+     * Model::setEvals(), eval_f and eval_g, JACOBIAN the first derivatives of
+     * eval_grad_f and eval_jac_g and HESSIAN eval_h
+     */
+    enum Phase {FORWARD, JACOBIAN, HESSIAN, NOF_PHASES};
+
+    ModelStats(): solve_time(0), hardware_counters(false){}
+
+    CallbackStats callbacks[NOF_CALLBACKS];
+
+    PhaseStats phases[NOF_PHASES];
+
+    //! cumulative wall time of solve() in seconds
+    double solve_time;
+
+    /*! \brief true if phases contain hardware counts, false if only timed
+     * \details the counts include the Model::eval_threads workers, but not
+     * the threads of the symbolic analysis
+     */
+    bool hardware_counters;
+
+    CallbackStats& operator[](const Callback& callback){
+        return callbacks[callback];
+    }
+
+    const CallbackStats& operator[](const Callback& callback) const {
+        return callbacks[callback];
+    }
+
+    //! cumulative wall time of all callbacks in seconds
+    double callbackTime() const {
+        double sum = 0;
+        for (int i=0; i<NOF_CALLBACKS; i++)
+            sum += callbacks[i].total_time;
+        return sum;
+    }
+
+    static const char* name(const Callback& callback){
+        static const char* names[NOF_CALLBACKS] = {"eval_f", "eval_grad_f",
+            "eval_g", "eval_jac_g", "eval_h"};
+        return names[callback];
+    }
+
+    static const char* name(const Phase& phase){
+        static const char* names[NOF_PHASES] = {"forward", "jacobian",
+            "hessian"};
+        return names[phase];
+    }
+};
+
+/*! \brief measures the wall time of its scope into stats
+ * \details does nothing if stats is nullptr, such that a disabled
+ * collection costs one branch per callback
+ */
+class CallbackTimer {
+    public:
+        CallbackTimer(CallbackStats* stats, bool new_x): stats(stats),
+                new_x(new_x){
+            if (stats != nullptr)
+                start = std::chrono::steady_clock::now();
+        }
+
+        ~CallbackTimer(){
+            if (stats != nullptr)
+                stats->record(std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start).count(),
+                        new_x);
+        }
+
+    private:
+        CallbackStats* stats;
+        bool new_x;
+        std::chrono::steady_clock::time_point start;
+};
+
+/*! \brief measures the wall time and the hardware counters of its scope
+ * into stats
+ * \details does nothing if stats is nullptr, counts only the time if
+ * counters is nullptr or not available
+ */
+class PhaseTimer {
+    public:
+        PhaseTimer(PhaseStats* stats, const PerfCounterSet* counters):
+                stats(stats), counters(counters){
+            if (stats == nullptr)
+                return;
+            if (counters != nullptr)
+                begin = counters->read();
+            start = std::chrono::steady_clock::now();
+        }
+
+        ~PhaseTimer(){
+            if (stats == nullptr)
+                return;
+            double seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+            stats->record(seconds, counters != nullptr ?
+                    counters->read() - begin : PerfCounts());
+        }
+
+    private:
+        PhaseStats* stats;
+        const PerfCounterSet* counters;
+        PerfCounts begin;
+        std::chrono::steady_clock::time_point start;
+};
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MADOPT_CHECKSTACK
+#define MADOPT_CHECKSTACK
+
+#include <vector>
+#include "stack.hpp"
+#include "exceptions.hpp"
+
+namespace MadOpt {
+
+/*! \brief replays the stack sizes and conflicts of a CStack sweep without
+ * computing any values
+ * \details used to check constraints loaded from a snapshot, the conflicts
+ * have to refer to entries of the merged elements and the stacks must not
+ * exceed the given sizes, throws a MadOptError otherwise. The conflicts are
+ * consumed like the CStack does it when it computes the hessian, the sweeps
+ * of a lower order read the same amount. The sizes the sweep needs are
+ * recorded, \sa max_g_size()
+ * \sa InnerConstraint::check()
+ */
+class CheckStack: public Stack {
+    public:
+        CheckStack(const Idx* conflicts, const Idx& nof_conflicts,
+                const Idx& max_g, const Idx& max_jac, const Idx& max_hess):
+            conflicts(conflicts), conflicts_end(conflicts + nof_conflicts),
+            max_g(max_g), g_size(0), g_peak(0), jac(max_jac),
+            hess(max_hess), dummy(0), data_i(0){}
+
+        void doAdd(const Idx& nofelems){
+            need(1 <= nofelems && nofelems <= size());
+            merge(jac, nofelems);
+            merge(hess, nofelems);
+            g_size -= nofelems - 1;
+        }
+
+        void doMull(const Idx& nofelems){
+            need(2 <= nofelems && nofelems <= size());
+            // each entry of a factor times the entries of the factors
+            // before it, \sa CStack::mulFactorsHess()
+            size_t before = 0;
+            for (Idx j=0; j<nofelems; j++){
+                const size_t& entries = elem(jac, nofelems, j);
+                push(hess, entries*before);
+                before += entries;
+            }
+            // squares of a variable with itself
+            const Idx counter = next();
+            for (Idx i=0; i<counter; i++){
+                const Idx& pos = next();
+                need(1 <= pos && pos < hess.total);
+            }
+            merge(hess, nofelems);
+            merge(jac, nofelems);
+            g_size -= nofelems - 1;
+        }
+
+        double& lastG(){
+            return dummy;
+        }
+
+        void doUnaryOp(const double&, const double&){
+            need(size() > 0);
+            const size_t& entries = jac.sizes.back();
+            emplace(hess, 0);
+            push(hess, entries*(entries + 1)/2);
+            merge(hess, 2);
+        }
+
+        void emplace_back(const Idx&){
+            push();
+            emplace(jac, 1);
+            emplace(hess, 0);
+        }
+
+        void emplace_back(const double&){
+            push();
+            emplace(jac, 0);
+            emplace(hess, 0);
+        }
+
+        Idx size(){
+            return g_size;
+        }
+
+        void clear(){
+            g_size = 0;
+            jac.clear();
+            hess.clear();
+            data_i = 0;
+        }
+
+        Idx& getDataI(){
+            return data_i;
+        }
+
+        //! checks the result of a sweep, all conflicts have to be used
+        void finish(const Idx& nof_jac, const Idx& nof_hess){
+            need(size() == 1 && conflicts == conflicts_end
+                    && jac.sizes.back() == nof_jac
+                    && hess.sizes.back() == nof_hess);
+        }
+
+        //! highest number of values, \sa SimStack::max_g_size()
+        Idx max_g_size()const { return g_peak; }
+
+        //! highest number of jacobian entries including the unused first
+        //one, 0 if there are none, \sa SimStack::max_jac_size()
+        Idx max_jac_size()const { return jac.peak; }
+
+        //! \sa max_jac_size()
+        Idx max_hess_size()const { return hess.peak; }
+
+    private:
+        //! sizes of a ListCStack
+        struct List {
+            List(const Idx& max): total(1), peak(0), max(max){}
+
+            void clear(){
+                sizes.clear();
+                total = 1;
+            }
+
+            //! entries of each element
+            std::vector<size_t> sizes;
+            //! entries of the stack, including the unused first one
+            size_t total;
+            //! like ListSimStack::max_size() only raised by pushed entries
+            size_t peak;
+            size_t max;
+        };
+
+        const Idx* conflicts;
+        const Idx* conflicts_end;
+        Idx max_g;
+        Idx g_size;
+        Idx g_peak;
+        List jac;
+        List hess;
+        double dummy;
+        Idx data_i;
+
+        static void need(const bool& condition){
+            if (not condition)
+                throw MadOptError("inconsistent constraint stacks");
+        }
+
+        void push(){
+            need(g_size < max_g);
+            g_size++;
+            if (g_size > g_peak)
+                g_peak = g_size;
+        }
+
+        const Idx& next(){
+            need(conflicts < conflicts_end);
+            return *(conflicts++);
+        }
+
+        static size_t& elem(List& list, const Idx& nofelems, const Idx& i){
+            return list.sizes[list.sizes.size() - nofelems + i];
+        }
+
+        void emplace(List& list, const size_t& entries){
+            list.sizes.push_back(0);
+            push(list, entries);
+        }
+
+        void push(List& list, const size_t& entries){
+            need(entries <= list.max);
+            // the unused first entry alone needs no space
+            if (entries == 0)
+                return;
+            list.sizes.back() += entries;
+            list.total += entries;
+            need(list.total <= list.max);
+            if (list.total > list.peak)
+                list.peak = list.total;
+        }
+
+        //! \sa ListCStack::merge()
+        void merge(List& list, const Idx& nofelems){
+            size_t entries = 0;
+            for (Idx i=0; i<nofelems; i++)
+                entries += elem(list, nofelems, i);
+            const size_t begin = list.total - entries;
+            const Idx counter = next();
+            for (Idx i=0; i<counter; i++){
+                const Idx& to = next();
+                const Idx& from = next();
+                need(begin <= to && to < from && from < list.total);
+                list.total--;
+            }
+            list.sizes.resize(list.sizes.size() - nofelems);
+            list.sizes.push_back(entries - counter);
+        }
+};
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
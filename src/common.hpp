@@ -81,6 +81,24 @@ unsigned int number_of_unique_elements(vector<T> v){
 	return std::set<T>(v.begin(), v.end()).size();
 }
 
+//! bytes allocated by the elements of v
+template<typename T>
+size_t memory(const vector<T>& v){
+    return v.capacity()*sizeof(T);
+}
+
+inline size_t memory(const vector<bool>& v){
+    return v.capacity()/8;
+}
+
+//! estimated bytes allocated by the buckets and nodes of the hash map m
+template<typename K, typename V, typename H>
+size_t memory(const unordered_map<K, V, H>& m){
+    return m.bucket_count()*sizeof(void*)
+        + m.size()*(sizeof(typename unordered_map<K, V, H>::value_type)
+                + 2*sizeof(void*));
+}
+
 #define FOREACH(elem, c) for(auto __it=c.begin(); __it!=c.end(); __it++){ auto& elem = *__it;
 
 }
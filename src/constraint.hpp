@@ -26,7 +26,7 @@ class Model;
 //solution values, can only be constructed via Model::addConstr()
 class Constraint {
     public: 
-        Constraint(){} // for python interface
+        Constraint(): model(nullptr), pos(0){} // for python interface
         Constraint(Model* model, Idx pos): model(model), pos(pos){}
 
         //! get the lower bound
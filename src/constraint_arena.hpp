@@ -0,0 +1,156 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_CONSTRAINT_ARENA_H
+#define MADOPT_CONSTRAINT_ARENA_H
+
+#include <vector>
+#include "common.hpp"
+#include "arena_array.hpp"
+#include "inner_param.hpp"
+#include "snapshot.hpp"
+#include "exceptions.hpp"
+
+namespace MadOpt {
+
+typedef char OPType;
+
+/*! \brief storage shared by the InnerConstraints of a model
+ * \details a constraint refers to its parts by offset and length, the
+ * arrays only grow, hence pointers into them are only valid until the next
+ * constraint is added. The arrays are stored on the heap or, after
+ * mapToFiles(), in memory mapped files.
+ */
+class ConstraintArena{
+    public:
+        ConstraintArena(): param_pool(nullptr){}
+
+        //! operators of the tapes
+        ArenaArray<OPType> ops;
+
+        //! one per operator that has data: counters, variable positions,
+        //slot indices and indices into consts and params
+        ArenaArray<Idx> operands;
+
+        ArenaArray<double> consts;
+
+        ArenaArray<InnerParam*> params;
+
+        //! pool of all params, nullptr as long as there are none
+        const ParamPool* param_pool;
+
+        //! slot offsets, jacobian entries, hessian maps and conflicts
+        ArenaArray<Idx> idx;
+
+        //! parameter slots and hessian values
+        ArenaArray<double> values;
+
+        /*! \brief moves the arrays into unlinked files in dir that are
+         * memory mapped
+         * \details the operating system pages the data in when the
+         * constraints are evaluated and can drop it again, hence the arena
+         * can be larger than the memory. The constraints are evaluated in the
+         * order they are stored, which keeps the file accesses sequential.
+         */
+        void mapToFiles(const string& dir){
+            ops.mapToFile(dir);
+            operands.mapToFile(dir);
+            consts.mapToFile(dir);
+            params.mapToFile(dir);
+            idx.mapToFile(dir);
+            values.mapToFile(dir);
+        }
+
+        bool fileBacked()const {
+            return ops.fileBacked();
+        }
+
+        //! exchanges the content with other, \sa Model::load()
+        void swap(ConstraintArena& other){
+            ops.swap(other.ops);
+            operands.swap(other.operands);
+            consts.swap(other.consts);
+            params.swap(other.params);
+            idx.swap(other.idx);
+            values.swap(other.values);
+            std::swap(param_pool, other.param_pool);
+        }
+
+        //! ParamPool::changes() of the params, 0 without params
+        size_t paramChanges()const {
+            return param_pool == nullptr ? 0 : param_pool->changes();
+        }
+
+        //! bytes allocated by the arena, on the heap or in files
+        size_t memory()const {
+            return tapeMemory() + mapMemory();
+        }
+
+        //! bytes allocated by ops, operands, consts and params
+        size_t tapeMemory()const {
+            return ops.memory() + operands.memory() + consts.memory()
+                + params.memory();
+        }
+
+        //! bytes allocated by idx and values
+        size_t mapMemory()const {
+            return idx.memory() + values.memory();
+        }
+
+        //! writes the arena to a snapshot, the parameters by their index,
+        //\sa Model::save()
+        void save(SnapshotWriter& out)const {
+            vector<Idx> param_idx;
+            FOREACH(p, params)
+                param_idx.push_back(p->getIdx());
+            }
+            out.array(ops.data(), ops.size());
+            out.array(operands.data(), operands.size());
+            out.array(consts.data(), consts.size());
+            out.array(param_idx);
+            out.array(idx.data(), idx.size());
+            out.array(values.data(), values.size());
+        }
+
+        //! replaces the content by the one of a snapshot, the parameters are
+        //taken from pool
+        void load(SnapshotReader& in, ParamPool& pool){
+            vector<Idx> param_idx;
+            load(in, ops);
+            load(in, operands);
+            load(in, consts);
+            in.array(param_idx);
+            load(in, idx);
+            load(in, values);
+            params.clear();
+            param_pool = &pool;
+            FOREACH(i, param_idx)
+                if (i >= pool.size())
+                    throw MadOptError("unknown parameter in snapshot");
+                params.push_back(pool[i]);
+            }
+        }
+
+    private:
+        template<class T>
+        static void load(SnapshotReader& in, ArenaArray<T>& array){
+            size_t n;
+            const T* data = in.array<T>(n);
+            array.assign(data, data + n);
+        }
+};
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -38,9 +38,36 @@ public:
     virtual Idx getNNZ_Jac() = 0;
     virtual void getNZ_Jac(unsigned int* jCol) = 0;
     virtual void setEvals(CStack&){}
+
+    //! computes the next point and writes the jacobian into jac, element i
+    //goes to jac[jac_map[i]] if jac_map is given, nothing is written if jac
+    //is nullptr
+    virtual void setEvals(CStack& stack, double* jac, const Idx* jac_map){
+        setEvals(stack);
+        if (jac == nullptr)
+            return;
+        const vector<double>& values = getJac();
+        for (Idx i=0; i<values.size(); i++)
+            jac[jac_map == nullptr ? i : jac_map[i]] = values[i];
+    }
+
     virtual const double& getG()const = 0;
     virtual const vector<double>& getJac()const = 0;
     virtual void eval_h(double* values, const double& lambda) = 0;
+
+    //! number of doubles written by saveEvals, constraints returning 0 can
+    //not be cached
+    virtual Idx evalsSize()const { return 0; }
+
+    //! writes the value and hessian of the last evaluation to data
+    virtual void saveEvals(double*)const {}
+
+    //! restores an evaluation written by saveEvals
+    virtual void loadEvals(const double*){}
+
+    //! bytes allocated by the constraint apart from a shared arena, 0 if
+    //unknown
+    virtual size_t memory()const { return 0; }
 };
 }
 #endif
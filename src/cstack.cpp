@@ -26,20 +26,54 @@ void CStack::doAdd(const Idx& nofelems){
     ASSERT_LE(nofelems, g_stack.size());
     ASSERT_LE(2, nofelems);
 
-    jac_stack.merge(nofelems);
-    hess_stack.merge(nofelems);
+    if (order > 0)
+        jac_stack.merge(nofelems);
+    else
+        jac_stack.skipMerge();
+    if (order > 1)
+        hess_stack.merge(nofelems);
+    else
+        hess_stack.skipMerge();
     double& goal = g_stack.back(nofelems);
     for (Idx i=0; i<nofelems-1; i++)
         goal += g_stack.pop();
 }
 
-void CStack::doMull(){
+void CStack::doMull(const Idx& nofelems){
     TRACE_START;
-    ASSERT_LE(2, g_stack.size());
+    ASSERT_LE(2, nofelems);
+    ASSERT_LE(nofelems, g_stack.size());
+    if (nofelems == 2)
+        mulPair();
+    else
+        mulFactors(nofelems);
+    TRACE_END;
+}
 
+void CStack::mulPair(){
+    TRACE_START;
     double& last = g_stack.pop();
     double& prev = g_stack.back();
     TRACE("last=", last, "prev=", prev);
+    if (order > 1)
+        mulPairHess(last, prev);
+    else {
+        conflicts.skip(conflicts.next());
+        hess_stack.skipMerge();
+    }
+
+    if (order > 0){
+        jac_stack.mulAllLast(prev);
+        jac_stack.mulAllPrev(last);
+        jac_stack.merge(2);
+    } else
+        jac_stack.skipMerge();
+    prev *= last;
+    TRACE_END;
+}
+
+void CStack::mulPairHess(const double& last, const double& prev){
+    TRACE_START;
     hess_stack.mulAllLast(prev);
     hess_stack.mulAllPrev(last);
 
@@ -50,23 +84,82 @@ void CStack::doMull(){
             TRACE(i, k);
             hess_stack.push(stack[i]*stack[k]);
         }
+    mergeHess(2);
+    TRACE_END;
+}
 
-    TRACE("conf elems", conflicts->str());
-    Idx& counter = conflicts->next();
-    for (Idx i=0; i<counter; i++){
-        TRACE("sol 00 conf", conflicts->current());
-        hess_stack.getStack()[conflicts->next()] *= 2;
+void CStack::mulFactors(const Idx& n){
+    TRACE_START;
+    // factor i is g_stack.back(n-i), prefix[i] is the product of the factors
+    // before it and suffix[i+1] the one of the factors after it
+    prefix[0] = 1;
+    for (Idx i=0; i<n; i++)
+        prefix[i+1] = prefix[i] * g_stack.back(n-i);
+    suffix[n] = 1;
+    for (Idx i=n; i>0; i--)
+        suffix[i-1] = suffix[i] * g_stack.back(n-i+1);
+
+    if (order > 1)
+        mulFactorsHess(n);
+    else {
+        conflicts.skip(conflicts.next());
+        hess_stack.skipMerge();
     }
 
-    hess_stack.merge(2);
+    if (order > 0){
+        for (Idx i=0; i<n; i++)
+            jac_stack.mulElem(n, i, prefix[i] * suffix[i+1]);
+        jac_stack.merge(n);
+    } else
+        jac_stack.skipMerge();
+    g_stack.back(n) = prefix[n];
+    g_stack.pop(n-1);
+    TRACE_END;
+}
 
-    jac_stack.mulAllLast(prev);
-    jac_stack.mulAllPrev(last);
-    jac_stack.merge(2);
-    prev *= last;
+void CStack::mulFactorsHess(const Idx& n){
+    TRACE_START;
+    for (Idx i=0; i<n; i++)
+        hess_stack.mulElem(n, i, prefix[i] * suffix[i+1]);
+
+    // the cross terms in the order of HessSimStack::setJac(), with the
+    // unscaled jacobians of the factors
+    const auto& stack = jac_stack.getStack();
+    for (Idx j=1; j<n; j++){
+        const Idx& begin = jac_stack.elemBegin(n, j);
+        const Idx& end = jac_stack.elemEnd(n, j);
+        if (begin == end)
+            continue;
+        // coefs[i] is the product of the factors other than i and j
+        double between = suffix[j+1];
+        for (Idx i=j; i>0; i--){
+            coefs[i-1] = prefix[i-1] * between;
+            between *= g_stack.back(n-i+1);
+        }
+        for (Idx e=begin; e<end; e++)
+            for (Idx i=0; i<j; i++){
+                const double value = stack[e] * coefs[i];
+                const Idx& i_end = jac_stack.elemEnd(n, i);
+                for (Idx k=jac_stack.elemBegin(n, i); k<i_end; k++){
+                    TRACE(e, k);
+                    hess_stack.push(value * stack[k]);
+                }
+            }
+    }
+    mergeHess(n);
     TRACE_END;
 }
 
+void CStack::mergeHess(const Idx& nofelems){
+    // the cross terms of a variable with itself count twice
+    const Idx& counter = conflicts.next();
+    for (Idx i=0; i<counter; i++){
+        TRACE("sol 00 conf", conflicts.current());
+        hess_stack.getStack()[conflicts.next()] *= 2;
+    }
+    hess_stack.merge(nofelems);
+}
+
 double& CStack::lastG(){
     TRACE_START;
     return g_stack.back();
@@ -74,6 +167,13 @@ double& CStack::lastG(){
 
 void CStack::doUnaryOp(const double& jac_value, const double& hess_value){
     TRACE_START;
+    if (order < 2){
+        hess_stack.skipMerge();
+        if (order > 0)
+            jac_stack.mulAllLast(jac_value);
+        TRACE_END;
+        return;
+    }
     hess_stack.mulAllLast(jac_value);
     const auto& stack = jac_stack.getStack();
     const auto& pos = jac_stack.getPos();
@@ -89,15 +189,19 @@ void CStack::doUnaryOp(const double& jac_value, const double& hess_value){
 void CStack::emplace_back(const Idx& id){
     TRACE_START;
     g_stack.pushSave(x[id]);
-    jac_stack.emplace_back(1);
-    hess_stack.emplace_back_empty();
+    if (order > 0)
+        jac_stack.emplace_back(1);
+    if (order > 1)
+        hess_stack.emplace_back_empty();
 }
 
 void CStack::emplace_back(const double& value){
     TRACE_START;
     g_stack.pushSave(value);
-    jac_stack.emplace_back_empty();
-    hess_stack.emplace_back_empty();
+    if (order > 0)
+        jac_stack.emplace_back_empty();
+    if (order > 1)
+        hess_stack.emplace_back_empty();
 }
 
 void CStack::clear(){
@@ -107,12 +211,18 @@ void CStack::clear(){
     data_i = 0;
 }
 
-void CStack::fill(double& g, double* jac, double* hess){
+void CStack::fill(double& g, double* jac, double* hess, const Idx* jac_map){
     //ASSERT_XOR(jac != nullptr, jac_stack.stackSize() > 0);
     //ASSERT_XOR(hess != nullptr, hess_stack.stackSize() > 0);
     g = g_stack.back();
-    jac_stack.fill(jac);
-    hess_stack.fill(hess);
+    if (order > 0 && jac != nullptr){
+        if (jac_map != nullptr)
+            jac_stack.fill(jac, jac_map);
+        else
+            jac_stack.fill(jac);
+    }
+    if (order > 1 && hess != nullptr)
+        hess_stack.fill(hess);
 }
 
 void CStack::resize(const SimStack& simstack){
@@ -122,6 +232,9 @@ void CStack::resize(const SimStack& simstack){
             simstack.max_jac_size(), 
             simstack.max_hess_size());
     g_stack.resize(simstack.max_g_size());
+    prefix.resize(simstack.max_g_size() + 1);
+    suffix.resize(simstack.max_g_size() + 1);
+    coefs.resize(simstack.max_g_size());
     jac_stack.resize(simstack.max_jac_size(), simstack.max_g_size());
     hess_stack.resize(simstack.max_hess_size(), simstack.max_g_size()+1);
     TRACE_END;
@@ -131,19 +244,51 @@ Idx CStack::size(){
     return g_stack.size();
 }
 
-void CStack::setConflicts(Array<Idx>* conflicts){
-    conflicts->reset();
-    jac_stack.setConflicts(conflicts);
-    hess_stack.setConflicts(conflicts);
-    this->conflicts = conflicts;
+void CStack::setConflicts(const Idx* conflicts){
+    this->conflicts.reset(conflicts);
+    jac_stack.setConflicts(&(this->conflicts));
+    hess_stack.setConflicts(&(this->conflicts));
 }
 
 void CStack::setX(const double* xx){
     x = xx;
 }
 
+const double* CStack::getX()const{
+    return x;
+}
+
 Idx& CStack::getDataI(){
     return data_i;
 }
 
+void CStack::setOrder(const Idx& o){
+    ASSERT_LE(o, 2);
+    order = o;
+}
+
+const Idx& CStack::getOrder()const{
+    return order;
+}
+
+size_t CStack::memory()const{
+    return g_stack.memory() + jac_stack.memory() + hess_stack.memory()
+        + prefix.memory() + suffix.memory() + coefs.memory();
+}
+
+void CStack::setWorkers(ThreadPool* p, CStack* w){
+    pool = p;
+    workers = w;
+}
+
+ThreadPool* CStack::getPool()const{
+    return pool;
+}
+
+CStack& CStack::getWorker(const size_t& worker){
+    if (worker == 0)
+        return *this;
+    return workers[worker-1];
+}
+
 }
@@ -23,13 +23,15 @@
 namespace MadOpt {
 
 class SimStack;
+class ThreadPool;
 
 class CStack: public Stack {
     public:
-	CStack(): data_i(0){}
+	CStack(): x(nullptr), data_i(0), order(2), pool(nullptr),
+            workers(nullptr){}
 
         void doAdd(const Idx& nofelems);
-        void doMull(); 
+        void doMull(const Idx& nofelems);
         double& lastG();
         void doUnaryOp(const double& jac_value, const double& hess_value);
         void emplace_back(const Idx& id);
@@ -37,23 +39,68 @@ class CStack: public Stack {
         void clear();
         Idx size();
 
-        void setConflicts(Array<Idx>* conflicts);
+        //! conflicts of the constraint the next sweep computes
+        void setConflicts(const Idx* conflicts);
 
-        void fill(double& g, double* jac, double* hess);
+        //! writes the results of the last sweep, jac and hess are skipped if
+        //they are nullptr, jac is scattered through jac_map if given
+        void fill(double& g, double* jac, double* hess,
+                const Idx* jac_map=nullptr);
 
         void resize(const SimStack& simstack);
 
         void setX(const double* xx);
 
+        const double* getX()const;
+
         Idx& getDataI();
 
+        //! highest derivative computed by the next sweeps, 2 computes the
+        //hessian, 1 stops after the jacobian, 0 only computes the value
+        void setOrder(const Idx& order);
+
+        const Idx& getOrder()const;
+
+        //! bytes allocated by the value, jacobian and hessian stacks
+        size_t memory()const;
+
+        //! pool evaluating the chunks of split sums, worker i>0 of pool uses
+        //workers[i-1], no pool evaluates them sequentially, \sa
+        //InnerConstraint::analyze()
+        void setWorkers(ThreadPool* pool, CStack* workers);
+
+        ThreadPool* getPool()const;
+
+        //! the stack of worker, this for worker 0
+        CStack& getWorker(const size_t& worker);
+
     private:
         Array<double> g_stack;
         ListCStack jac_stack;
         ListCStack hess_stack;
-        Array<Idx>* conflicts;
+        ConflictCursor conflicts;
         const double* x;
         Idx data_i;
+        Idx order;
+        //! products of the factors of mulFactors()
+        Array<double> prefix;
+        Array<double> suffix;
+        Array<double> coefs;
+        ThreadPool* pool;
+        CStack* workers;
+
+        //! doMull() of two factors
+        void mulPair();
+        void mulPairHess(const double& last, const double& prev);
+
+        //! doMull() of n factors, linear in the jacobian entries of the
+        //factors and the cross terms of their hessian
+        void mulFactors(const Idx& n);
+        void mulFactorsHess(const Idx& n);
+
+        //! doubles the squares of the last cross terms and merges the
+        //hessians of the last nofelems elements
+        void mergeHess(const Idx& nofelems);
 };
 }
 #endif
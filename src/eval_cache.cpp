@@ -0,0 +1,177 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "eval_cache.hpp"
+
+#include <string.h>
+#include <stdint.h>
+
+namespace MadOpt {
+
+EvalCache::Entry* EvalCache::lookup(const double* x, const Idx& nx,
+        const Idx& rows, const Idx& jac, const Idx& grad, bool& hit){
+    hit = false;
+    size_t bytes = sizeof(Entry) + sizeof(double)*((size_t)nx + rows + jac + grad);
+    if (bytes != entry_bytes){
+        clear();
+        spare.clear();
+        entry_bytes = bytes;
+    }
+    if (bytes > budget)
+        return nullptr;
+
+    size_t key = hash(x, nx);
+    const size_t mask = slots.size() - 1;
+    for (size_t i=key & mask; not slots.empty() && slots[i].used;
+            i=(i+1) & mask){
+        Entry& entry = *(slots[i].entry);
+        if (entry.key == key
+                && memcmp(entry.x.data(), x, sizeof(double)*nx) == 0){
+            entries.splice(entries.begin(), entries, slots[i].entry);
+            hits++;
+            hit = true;
+            return &entry;
+        }
+    }
+    misses++;
+
+    if ((entries.size()+1)*entry_bytes > budget){
+        // reuse the buffers of the least recently used entry
+        EntryIter last = --entries.end();
+        unindex(last);
+        entries.splice(entries.begin(), entries, last);
+    } else if (not spare.empty())
+        entries.splice(entries.begin(), spare, spare.begin());
+    else
+        entries.emplace_front();
+
+    // no-ops for a reused entry
+    Entry& entry = entries.front();
+    entry.x.resize(nx);
+    entry.rows.resize(rows);
+    entry.jac.resize(jac);
+    entry.grad.resize(grad);
+    std::copy(x, x+nx, entry.x.begin());
+    entry.con_order = -1;
+    entry.obj_order = -1;
+    entry.has_jac = false;
+    entry.has_grad = false;
+    entry.key = key;
+    index(entries.begin());
+    return &entry;
+}
+
+void EvalCache::setBudget(const size_t& bytes){
+    budget = bytes;
+    evict();
+}
+
+const size_t& EvalCache::getBudget()const{
+    return budget;
+}
+
+void EvalCache::clear(){
+    spare.splice(spare.end(), entries);
+    for (Idx i=0; i<slots.size(); i++)
+        slots[i].used = false;
+    nof_slots_used = 0;
+}
+
+const size_t& EvalCache::nofHits()const{
+    return hits;
+}
+
+const size_t& EvalCache::nofMisses()const{
+    return misses;
+}
+
+size_t EvalCache::size()const{
+    return entries.size();
+}
+
+const size_t& EvalCache::entryBytes()const{
+    return entry_bytes;
+}
+
+size_t EvalCache::memory()const{
+    return (entries.size() + spare.size())*entry_bytes
+        + MadOpt::memory(slots);
+}
+
+size_t EvalCache::hash(const double* x, const Idx& nx){
+    uint64_t h = 14695981039346656037ULL;
+    for (Idx i=0; i<nx; i++){
+        uint64_t bits;
+        memcpy(&bits, &(x[i]), sizeof(bits));
+        h = (h ^ bits) * 1099511628211ULL;
+        h ^= h >> 29;
+    }
+    return (size_t)h;
+}
+
+void EvalCache::index(const EntryIter& entry){
+    growIndex();
+    const size_t mask = slots.size() - 1;
+    size_t i = entry->key & mask;
+    while (slots[i].used)
+        i = (i+1) & mask;
+    slots[i].entry = entry;
+    slots[i].used = true;
+    nof_slots_used++;
+}
+
+void EvalCache::unindex(const EntryIter& entry){
+    const size_t mask = slots.size() - 1;
+    size_t i = entry->key & mask;
+    while (slots[i].entry != entry)
+        i = (i+1) & mask;
+    // shift the following entries back, such that no probe sequence has a gap
+    for (size_t j=(i+1) & mask; slots[j].used; j=(j+1) & mask){
+        size_t home = slots[j].entry->key & mask;
+        bool between = i <= j ? (i < home && home <= j)
+            : (i < home || home <= j);
+        if (not between){
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i].used = false;
+    nof_slots_used--;
+}
+
+void EvalCache::growIndex(){
+    if (2*(nof_slots_used+1) <= slots.size())
+        return;
+    vector<Slot> old;
+    old.swap(slots);
+    slots.resize(std::max<size_t>(16, 2*old.size()), Slot{EntryIter(), false});
+    nof_slots_used = 0;
+    FOREACH(slot, old)
+        if (slot.used)
+            index(slot.entry);
+    }
+}
+
+void EvalCache::evict(){
+    spare.clear();
+    while (!entries.empty() && entries.size()*entry_bytes > budget){
+        EntryIter last = --entries.end();
+        unindex(last);
+        entries.erase(last);
+    }
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
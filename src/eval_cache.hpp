@@ -0,0 +1,123 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_EVAL_CACHE_H
+#define MADOPT_EVAL_CACHE_H
+
+#include <list>
+#include "common.hpp"
+
+namespace MadOpt {
+
+/*! \brief least recently used cache of evaluations, keyed by the point x
+ * \details entries are only allocated while the cache fills up, once it is
+ * full the least recently used entry is reused and clear() keeps the
+ * entries for reuse, such that a lookup does not allocate in steady state
+ */
+class EvalCache {
+    public:
+        struct Entry {
+            //! the point
+            vector<double> x;
+            //! saved evaluations of the objective followed by all constraints
+            vector<double> rows;
+            //! constraint jacobian
+            vector<double> jac;
+            //! objective jacobian in obj_jac_map order
+            vector<double> grad;
+            //! highest derivative order saved in rows, -1 if none
+            int con_order;
+            int obj_order;
+            bool has_jac;
+            bool has_grad;
+            size_t key;
+        };
+
+        EvalCache(): nof_slots_used(0), budget(0), entry_bytes(0), hits(0),
+            misses(0){}
+
+        /*! \brief returns the entry for the point x
+         * \details if x is not cached a new entry is created, evicting the
+         * least recently used entries to stay within the budget, nullptr is
+         * returned if a single entry does not fit into the budget
+         * @param[in] x the point
+         * @param[in] nx size of x
+         * @param[in] rows size of Entry::rows
+         * @param[in] jac size of Entry::jac
+         * @param[in] grad size of Entry::grad
+         * @param[out] hit true if the entry was found
+         */
+        Entry* lookup(const double* x, const Idx& nx, const Idx& rows,
+                const Idx& jac, const Idx& grad, bool& hit);
+
+        //! sets the memory budget in bytes, 0 disables the cache
+        void setBudget(const size_t& bytes);
+
+        const size_t& getBudget()const;
+
+        //! removes all entries, their buffers are kept for new entries
+        void clear();
+
+        //! number of lookups that found their point
+        const size_t& nofHits()const;
+
+        //! number of lookups that did not find their point
+        const size_t& nofMisses()const;
+
+        //! number of cached points
+        size_t size()const;
+
+        //! bytes of one entry, 0 before the first lookup
+        const size_t& entryBytes()const;
+
+        //! bytes used by the cached and the kept entries and the index
+        size_t memory()const;
+
+    private:
+        typedef list<Entry>::iterator EntryIter;
+
+        //! slot of the open addressing index of the entries
+        struct Slot {
+            EntryIter entry;
+            bool used;
+        };
+
+        //! most recently used first
+        list<Entry> entries;
+        //! entries removed by clear(), reused before allocating new ones
+        list<Entry> spare;
+        //! linear probing by Entry::key, the size is a power of two
+        vector<Slot> slots;
+        Idx nof_slots_used;
+        size_t budget;
+        size_t entry_bytes;
+        size_t hits;
+        size_t misses;
+
+        static size_t hash(const double* x, const Idx& nx);
+
+        void index(const EntryIter& entry);
+
+        void unindex(const EntryIter& entry);
+
+        //! doubles the slots if they are half full
+        void growIndex();
+
+        void evict();
+};
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
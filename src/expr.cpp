@@ -41,11 +41,19 @@ Expr::Expr(int constant){
         *this = a;
       } else {
         *this = a;
-        if (getType() == OP_POW){
-          front().modifyValue(b, true);
-        } else {
-          ops.emplace_front(OP_POW, b);
+        double exponent = b;
+        if (isPower(getType())){
+          exponent *= front().getExponent();
+          ops.pop_front();
+          // e.g. pow(sqrt(x), 2)
+          if (exponent == 1)
+            return;
         }
+        OPType type = powerType(exponent);
+        if (type == OP_POW || type == OP_IPOW)
+          ops.emplace_front(type, exponent);
+        else
+          ops.emplace_front(type);
       }
     } else {
       throw MadOptError("wrong use of Expression type a_b_op");
@@ -53,14 +61,16 @@ Expr::Expr(int constant){
 }
 
 Expr::Expr(const Expr& a, int op){
-    if (op != OP_SIN && op != OP_COS && op != OP_TAN && op != OP_LN && op != OP_LOG2)
+    if (op != OP_SIN && op != OP_COS && op != OP_TAN && op != OP_LN && op != OP_LOG2
+            && op != OP_EXP)
         throw MadOptError("wrong use of Expression type a_op");
     *this = a;
     ops.emplace_front(op);
 }
 
 Expr::Expr(const Expr& a, OPType op){ 
-  if (op != OP_SIN && op != OP_COS && op != OP_TAN && op != OP_LN && op != OP_LOG2)
+  if (op != OP_SIN && op != OP_COS && op != OP_TAN && op != OP_LN && op != OP_LOG2
+          && op != OP_EXP)
         throw MadOptError("wrong use of Expression type a_op");
     *this = a; 
     ops.emplace_front(op); 
@@ -155,7 +165,14 @@ Expr pow(const Expr& a, const double& b){
 }
 
 Expr operator/(const Expr& a, const Expr& b){
-    return a * pow(b, -1);
+    if (b.isConstant())
+        return a * (1 / b.front().getValue());
+    if (a.isZero())
+        return a;
+    Expr res(b);
+    res.ops.emplace_front(OP_DIV);
+    res.ops.insert(res.ops.end(), a.begin(), a.end());
+    return res;
 }
 
 Expr sin(const Expr& a){
@@ -174,6 +191,10 @@ Expr sqrt(const Expr& a){
     return pow(a, 0.5);
 }
 
+Expr exp(const Expr& a){
+    return Expr(a, OP_EXP);
+}
+
 Expr ln(const Expr& a){
   return Expr(a, OP_LN);
 }
@@ -302,8 +323,21 @@ string Expr::toString(list<Operator>::const_iterator& iter)const {
         case OP_MUL_CONST:
             return doubleToString(op.getValue()) + "*" + toStringEnclosed(++iter);
         case OP_POW:
+        case OP_IPOW:
+        case OP_SQR:
+        case OP_INV:
+        case OP_SQRT:
           res = toStringEnclosed(++iter);
-            return res + "^" + doubleToString(op.getValue());
+            return res + "^" + doubleToString(op.getExponent());
+        case OP_DIV:
+            // a product is enclosed as divisor
+            if ((++iter)->getType() == OP_MUL)
+                res = "(" + toString(iter) + ")";
+            else
+                res = toStringEnclosed(iter);
+            return toStringEnclosed(++iter) + "/" + res;
+        case OP_EXP:
+            return "exp(" + toString(++iter) + ")";
     case OP_LN:
       return "ln(" + toString(++iter) + ")";
     case OP_LOG2:
@@ -326,7 +360,8 @@ string Expr::toString(list<Operator>::const_iterator& iter)const {
 string Expr::toStringEnclosed(list<Operator>::const_iterator& iter)const{
     const OPType& t = iter->getType();
     if (t == OP_VAR_POINTER || t == OP_PARAM_POINTER ||
-            t == OP_CONST || t == OP_MUL || t == OP_SIN || t == OP_COS || t == OP_TAN || t == OP_LOG2 || t == OP_LN)
+            t == OP_CONST || t == OP_MUL || t == OP_SIN || t == OP_COS || t == OP_TAN || t == OP_LOG2 || t == OP_LN
+            || t == OP_EXP)
         return toString(iter);
     return "(" + toString(iter) + ")";
 }
@@ -402,7 +437,16 @@ double Expr::x(list<Operator>::const_iterator& iter)const {
         case OP_MUL_CONST:
             return op.getValue()*x(++iter);
         case OP_POW:
-            return std::pow(x(++iter), op.getValue());
+        case OP_IPOW:
+        case OP_SQR:
+        case OP_INV:
+        case OP_SQRT:
+            return std::pow(x(++iter), op.getExponent());
+        case OP_DIV:
+            tmp = x(++iter);
+            return x(++iter) / tmp;
+        case OP_EXP:
+            return std::exp(x(++iter));
     case OP_LN:
       return std::log(x(++iter));
     case OP_LOG2:
@@ -94,6 +94,7 @@ class Expr{
         friend Expr cos(const Expr& a);
         friend Expr tan(const Expr& a);
         friend Expr sqrt(const Expr& a);
+        friend Expr exp(const Expr& a);
 
         string opsToString()const;
 
@@ -183,6 +184,8 @@ Expr tan(const Expr& a);
 //! \sa
 Expr sqrt(const Expr& a);
 //! \sa
+Expr exp(const Expr& a);
+//! \sa
 Expr log2(const Expr& a);
 //! \sa
 Expr ln(const Expr& a);
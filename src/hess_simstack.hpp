@@ -28,30 +28,41 @@ namespace MadOpt {
 class HessSimStack : public ListSimStack<PII> {
     public:
 
-        void setJac(const JacSimStack& jac){
+        /*! \brief pushes the products of the jacobians of the last
+         * nofelems elements of jac, for their product
+         * \details each entry of element j is multiplied with the entries
+         * of the elements before it, in order, the positions of products of
+         * a variable with itself are recorded as conflicts
+         */
+        void setJac(const JacSimStack& jac, const Idx& nofelems){
             TRACE_START;
             ASSERT_LE(positions.back(), stack.size());
+            ASSERT_LE(2, nofelems);
             Idx conflict_counter_pos = conflicts->getEndPosAndPush();
             (*conflicts)[conflict_counter_pos] = 0;
             const auto& jac_stack = jac.getStack();
             const auto& pos = jac.getPos();
-            ASSERT_BETWEEN(pos.back(2), pos.back(1), jac_stack.size(),
-                    pos.back(2), pos.back(1), jac_stack.size() );
-            for (Idx i=pos.back(1); i<jac_stack.size(); i++){
-                const auto& elem2 = jac_stack[i];
-                for (Idx k=pos.back(2); k<pos.back(); k++){
-                    const auto& elem1 = jac_stack[k];
-                    if (elem1.id == elem2.id){
-                        (*conflicts)[conflict_counter_pos]++;
-                        conflicts->push(stack.size());
-                        ASSERT_LE(1, stack.size());
-                        ASSERT_LE(1, (*conflicts)[conflict_counter_pos]);
-                        TRACE("ins 00 conf", 
-                                (*conflicts)[conflict_counter_pos], stack.size(),
-                                conflicts->size());
+            ASSERT_LE(pos.back(nofelems), jac_stack.size());
+            for (Idx j=1; j<nofelems; j++){
+                const Idx& begin = pos.back(nofelems-j);
+                const Idx end = j+1 < nofelems ? pos.back(nofelems-j-1)
+                    : jac_stack.size();
+                for (Idx i=begin; i<end; i++){
+                    const auto& elem2 = jac_stack[i];
+                    for (Idx k=pos.back(nofelems); k<begin; k++){
+                        const auto& elem1 = jac_stack[k];
+                        if (elem1.id == elem2.id){
+                            (*conflicts)[conflict_counter_pos]++;
+                            conflicts->push(stack.size());
+                            ASSERT_LE(1, stack.size());
+                            ASSERT_LE(1, (*conflicts)[conflict_counter_pos]);
+                            TRACE("ins 00 conf",
+                                    (*conflicts)[conflict_counter_pos],
+                                    stack.size(), conflicts->size());
+                        }
+                        TRACE("push new elem", i, k, elem1.id, elem2.id);
+                        push(uPII(elem1.id, elem2.id));
                     }
-                    TRACE("push new elem", i, k, elem1.id, elem2.id);
-                    push(uPII(elem1.id, elem2.id));
                 }
             }
             TRACE_END;
@@ -78,6 +89,11 @@ class HessSimStack : public ListSimStack<PII> {
             return res;
         }
 
+        //! bytes allocated by the stack
+        size_t memory()const {
+            return ListSimStack<PII>::memory() + last_pos_map.memory();
+        }
+
     private:
         PairHashMap last_pos_map;
 
@@ -15,7 +15,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <cmath>
+#include <algorithm>
+#include <unordered_map>
 #include "inner_constraint.hpp"
 #include "logger.hpp"
 #include "exceptions.hpp"
@@ -26,18 +29,40 @@
 #include "stack.hpp"
 #include "simstack.hpp"
 #include "cstack.hpp"
+#include "param_stack.hpp"
+#include "check_stack.hpp"
+#include "inner_var.hpp"
+#include "threadpool.hpp"
+#include "timeline.hpp"
 
 namespace MadOpt {
 
 void InnerConstraint::eval_h(double* values, const double& lambda){
-    ASSERT_EQ(hess.size(), hess_map.size());
-    for (Idx i=0; i<hess.size(); i++){
+    const double* hess = arena->values.data() + hess_values;
+    const Idx* hess_map = arena->idx.data() + hess_map_begin;
+    for (Idx i=0; i<nof_hess; i++){
         VALGRIND_CONDITIONAL_JUMP_TEST(hess[i]);
         VALGRIND_CONDITIONAL_JUMP_TEST(hess_map[i]);
         values[hess_map[i]] += lambda * hess[i];
     }
 }
 
+Idx InnerConstraint::evalsSize()const{
+    return 1 + nof_hess;
+}
+
+void InnerConstraint::saveEvals(double* data)const{
+    data[0] = g;
+    const double* hess = arena->values.data() + hess_values;
+    std::copy(hess, hess + nof_hess, &(data[1]));
+}
+
+void InnerConstraint::loadEvals(const double* data){
+    g = data[0];
+    std::copy(&(data[1]), &(data[1 + nof_hess]),
+            arena->values.data() + hess_values);
+}
+
 const double& InnerConstraint::getG()const { 
     return g; 
 }
@@ -46,12 +71,14 @@ const vector<double>& InnerConstraint::getJac()const {
     return jac;
 }
 
-const vector<double>& InnerConstraint::getHess()const {
-    return hess;
+vector<double> InnerConstraint::getHess()const {
+    auto begin = arena->values.begin() + hess_values;
+    return vector<double>(begin, begin + nof_hess);
 }
 
-const vector<Idx>& InnerConstraint::getHessMap()const{
-    return hess_map;
+vector<Idx> InnerConstraint::getHessMap()const{
+    auto begin = arena->idx.begin() + hess_map_begin;
+    return vector<Idx>(begin, begin + nof_hess);
 }
 
 InnerConstraint::InnerConstraint(
@@ -59,53 +86,398 @@ InnerConstraint::InnerConstraint(
         const double _lb,
         const double _ub,
         HessPosMap& hess_pos_map,
-        SimStack& stack): 
-    _lb(_lb), 
-    _ub(_ub)
+        SimStack& stack,
+        ConstraintArena* arena): 
+    InnerConstraint(expr, _lb, _ub, arena)
 {
+    analyze(stack);
+    mapHess(hess_pos_map);
+}
+
+static InnerConstraint::Tape toTape(const Expr& expr){
+    InnerConstraint::Tape tape;
     auto& ops = expr.getOps();
     for (auto iter=ops.rbegin(); iter!=ops.rend(); iter++){
         auto op = *iter;
         auto type = op.getType();
 
-        operators.push_back(type);
-        if (type == OP_VAR_POINTER
-                || type == OP_ADD
-                || type == OP_MUL
-                || type == OP_POW
-                || type == OP_CONST
-                || type == OP_VAR_IDX
-                || type == OP_PARAM_POINTER){
-            data.push_back(op.getData());
+        tape.ops.push_back(type);
+        if (InnerConstraint::hasData(type)){
+            tape.data.push_back(op.getData());
         } else {
             ASSERT(type == OP_COS
                     || type == OP_SIN
                     || type == OP_TAN
                    || type == OP_LOG2
-                   || type == OP_LN,
+                   || type == OP_LN
+                   || type == OP_SQR
+                   || type == OP_INV
+                   || type == OP_SQRT
+                   || type == OP_EXP
+                   || type == OP_DIV,
                     "unknown type", type);
         }
     }
+    return tape;
+}
+
+InnerConstraint::InnerConstraint(
+        const Expr& expr,
+        const double _lb,
+        const double _ub,
+        ConstraintArena* arena): 
+    InnerConstraint(toTape(expr), _lb, _ub, arena){}
+
+InnerConstraint::InnerConstraint(
+        Tape tape,
+        const double _lb,
+        const double _ub,
+        ConstraintArena* arena): 
+    own_arena(arena == nullptr ? new ConstraintArena() : nullptr),
+    arena(arena == nullptr ? own_arena.get() : arena),
+    nof_jac(0),
+    nof_hess(0),
+    nof_conflicts(0),
+    analyzed(false),
+    param_changes(0),
+    _lb(_lb), 
+    _ub(_ub)
+{
+    vector<Idx> slot_ops;
+    vector<Idx> slot_data;
+    hoistParamExprs(tape.ops, tape.data, slot_ops, slot_data);
+    compile(tape.ops, tape.data, slot_ops, slot_data);
+    updateParamSlots();
+}
+
+InnerConstraint::InnerConstraint(const Layout& layout,
+        ConstraintArena* arena):
+    own_arena(arena == nullptr ? new ConstraintArena() : nullptr),
+    arena(arena == nullptr ? own_arena.get() : arena),
+    ops_begin(layout.ops_begin),
+    operands_begin(layout.operands_begin),
+    tape_size(layout.tape_size),
+    slots_begin(layout.slots_begin),
+    nof_slots(layout.nof_slots),
+    slot_values(layout.slot_values),
+    jac_begin(layout.jac_begin),
+    nof_jac(layout.nof_jac),
+    hess_map_begin(layout.hess_map_begin),
+    hess_values(layout.hess_values),
+    nof_hess(layout.nof_hess),
+    conflicts_begin(layout.conflicts_begin),
+    nof_conflicts(layout.nof_conflicts),
+    analyzed(true),
+    param_changes(this->arena->paramChanges()),
+    _lb(layout.lb),
+    _ub(layout.ub)
+{}
+
+InnerConstraint::Layout InnerConstraint::layout()const {
+    ASSERT(analyzed);
+    return {ops_begin, operands_begin, tape_size, slots_begin, nof_slots,
+        slot_values, jac_begin, nof_jac, hess_map_begin, hess_values,
+        nof_hess, conflicts_begin, nof_conflicts, 0, _lb, _ub};
+}
+
+bool InnerConstraint::fits(const Layout& l, const ConstraintArena& arena){
+    auto within = [](const size_t& begin, const size_t& n, const size_t& size){
+        return begin <= size && n <= size - begin;
+    };
+    return within(l.ops_begin, l.tape_size, arena.ops.size())
+        && within(l.slots_begin, 2*(size_t)l.nof_slots + 1, arena.idx.size())
+        && within(l.slot_values, l.nof_slots, arena.values.size())
+        && within(l.jac_begin, l.nof_jac, arena.idx.size())
+        && within(l.hess_map_begin, l.nof_hess, arena.idx.size())
+        && within(l.hess_values, l.nof_hess, arena.values.size())
+        && within(l.conflicts_begin, l.nof_conflicts, arena.idx.size())
+        && l.operands_begin <= arena.operands.size();
+}
+
+bool InnerConstraint::check(const Idx& nx, const Idx& nof_hess_pos,
+        const Idx& max_g, const Idx& max_jac, const Idx& max_hess,
+        SimStack& sizes){
+    TRACE_START;
+    ASSERT(analyzed);
+    const Idx* slot_ops = arena->idx.data() + slots_begin;
+    const Idx* slot_data = slot_ops + nof_slots + 1;
+    if (slot_ops[0] != tape_size
+            || slot_ops[nof_slots] > arena->ops.size() - ops_begin
+            || not checkOps(0, tape_size, 0, nx, false))
+        return false;
+    for (Idx i=0; i<nof_slots; i++)
+        if (slot_ops[i] > slot_ops[i+1]
+                || not checkOps(slot_ops[i], slot_ops[i+1], slot_data[i], nx,
+                    true))
+            return false;
+
+    const Idx* jac_entries = arena->idx.data() + jac_begin;
+    for (Idx i=0; i<nof_jac; i++)
+        if (jac_entries[i] >= nx)
+            return false;
+    const Idx* hess_map = arena->idx.data() + hess_map_begin;
+    for (Idx i=0; i<nof_hess; i++)
+        if (hess_map[i] >= nof_hess_pos)
+            return false;
+
+    CheckStack stack(arena->idx.data() + conflicts_begin, nof_conflicts,
+            max_g, max_jac, max_hess);
+    try {
+        computeFinalStack(stack);
+        stack.finish(nof_jac, nof_hess);
+    } catch (const MadOptError&){
+        return false;
+    }
+    sizes.raiseMaxSizes(stack.max_g_size(), stack.max_jac_size(),
+            stack.max_hess_size());
+    TRACE_END;
+    return true;
+}
+
+bool InnerConstraint::checkOps(const Idx& begin, const Idx& end, Idx data_i,
+        const Idx& nx, const bool& slot)const {
+    const OPType* ops = arena->ops.data() + ops_begin;
+    // number of operands on the stack while the tape is evaluated
+    Idx depth = 0;
+    for (Idx i=begin; i<end; i++){
+        const OPType& type = ops[i];
+        Idx operand = 0;
+        if (hasData(type)){
+            if (operands_begin + (size_t) data_i >= arena->operands.size())
+                return false;
+            operand = arena->operands[operands_begin + data_i++];
+        }
+        Idx nof_children = 1;
+        switch(type){
+            case OP_VAR_IDX:
+                if (slot || operand >= nx)
+                    return false;
+                nof_children = 0;
+                break;
+            case OP_PARAM_SLOT:
+                if (slot || operand >= nof_slots)
+                    return false;
+                nof_children = 0;
+                break;
+            case OP_PARAM_POINTER:
+                if (operand >= arena->params.size())
+                    return false;
+                nof_children = 0;
+                break;
+            case OP_CONST:
+                if (operand >= arena->consts.size())
+                    return false;
+                nof_children = 0;
+                break;
+            case OP_POW:
+                if (operand >= arena->consts.size())
+                    return false;
+                break;
+            case OP_IPOW:
+                // caseIPOW() converts the exponent to an integer
+                if (operand >= arena->consts.size()
+                        || not isIntegral(arena->consts[operand]))
+                    return false;
+                break;
+            case OP_ADD:
+            case OP_MUL:
+                if (operand == 0)
+                    return false;
+                nof_children = operand;
+                break;
+            case OP_DIV:
+                nof_children = 2;
+                break;
+            case OP_SQR:
+            case OP_INV:
+            case OP_SQRT:
+            case OP_EXP:
+            case OP_SIN:
+            case OP_COS:
+            case OP_TAN:
+            case OP_LOG2:
+            case OP_LN:
+                break;
+            default:
+                return false;
+        }
+        if (nof_children > depth)
+            return false;
+        depth = depth - nof_children + 1;
+    }
+    return depth == 1;
+}
 
-    stack.setConflicts(&conflicts);
+void InnerConstraint::analyze(SimStack& stack, const Idx& max_chunks,
+        const Idx& chunk_terms){
+    TRACE_START;
+    ASSERT(not analyzed && analysis == nullptr);
+    analysis.reset(new Analysis());
+    stack.setConflicts(&(analysis->conflicts));
     ASSERT_EQ(stack.size(), 0);
     computeFinalStack(stack);
     ASSERT_EQ(stack.size(), 1);
-    vector<PII> hess_entries = stack.getHessEntries();
-    FOREACH(p, hess_entries)
-    //for (auto& p : hess_entries){
-        hess_pos_map.insert({p, hess_pos_map.size()}); // Only inserts if new.
-        hess_map.push_back(hess_pos_map[p]);
-    }
-    hess.resize(hess_map.size());
-    ASSERT_EQ(hess.size(), hess_entries.size());
-    jac_entries = stack.getJacEntries();
-    ASSERT_IF(operators.back() != OP_CONST, jac_entries.size() > 0);
-    jac.resize(jac_entries.size());
-    ASSERT_IF(operators.back() != OP_CONST, jac.data() != nullptr);
-    TRACE("conf elems", conflicts.str());
+    analysis->hess_entries = stack.getHessEntries();
+    analysis->jac_entries = stack.getJacEntries();
+    DEBUG_CODE(const auto& last_op = arena->ops[ops_begin + tape_size - 1]);
+    ASSERT_IF(last_op != OP_CONST && last_op != OP_PARAM_SLOT,
+            analysis->jac_entries.size() > 0);
+    TRACE("conf elems", analysis->conflicts.str());
     TRACE("final simstack", stack.str());
     stack.clear();
+    if (max_chunks > 1)
+        splitSum(stack, max_chunks, std::max<Idx>(chunk_terms, 1));
+    TRACE_END;
+}
+
+void InnerConstraint::splitSum(SimStack& stack, const Idx& max_chunks,
+        const Idx& chunk_terms){
+    TRACE_START;
+    const OPType* ops = arena->ops.data() + ops_begin;
+    const Idx* operands = arena->operands.data() + operands_begin;
+    const Idx root = tape_size - 1;
+    if (ops[root] != OP_ADD)
+        return;
+
+    // first operator and operand of the sub expressions on the stack, at
+    // the root these are its terms
+    vector<std::pair<Idx, Idx>> terms;
+    Idx operand = 0;
+    for (Idx i=0; i<root; i++){
+        const auto& type = ops[i];
+        std::pair<Idx, Idx> start(i, operand);
+        Idx nof_children = 1;
+        if (type == OP_ADD || type == OP_MUL)
+            nof_children = operands[operand];
+        else if (type == OP_DIV)
+            nof_children = 2;
+        else if (type == OP_VAR_IDX || type == OP_CONST
+                || type == OP_PARAM_POINTER || type == OP_PARAM_SLOT)
+            nof_children = 0;
+        if (hasData(type))
+            operand++;
+        ASSERT_LE(nof_children, terms.size());
+        if (nof_children > 0){
+            start = terms[terms.size() - nof_children];
+            terms.resize(terms.size() - nof_children);
+        }
+        terms.push_back(start);
+    }
+    const Idx nof_terms = terms.size();
+    ASSERT_EQ(nof_terms, operands[operand]);
+    const Idx nof_chunks = std::min(max_chunks, nof_terms / chunk_terms);
+    if (nof_chunks < 2)
+        return;
+
+    // consecutive terms with about the same number of operators each
+    std::unique_ptr<Split> s(new Split());
+    Idx first = 0;
+    for (Idx c=0; c<nof_chunks; c++){
+        Idx last = nof_terms;
+        if (c + 1 < nof_chunks){
+            const Idx min_last = first + chunk_terms;
+            const Idx max_last = nof_terms - (nof_chunks-c-1) * chunk_terms;
+            const Idx target = (Idx)((size_t)root * (c+1) / nof_chunks);
+            last = min_last;
+            while (last < max_last && terms[last].first < target)
+                last++;
+        }
+        Idx ops_end = last < nof_terms ? terms[last].first : root;
+        s->chunks.push_back({terms[first].first, ops_end,
+                terms[first].second, last - first, 0, 0, 0, 0});
+        first = last;
+    }
+
+    // chunk entries in the order of the entries of the constraint
+    std::unordered_map<Idx, Idx> jac_pos;
+    for (Idx i=0; i<analysis->jac_entries.size(); i++)
+        jac_pos[analysis->jac_entries[i]] = i;
+    HessPosMap hess_pos;
+    for (Idx i=0; i<analysis->hess_entries.size(); i++)
+        hess_pos[analysis->hess_entries[i]] = i;
+    vector<Idx> jac_row;
+    vector<Idx> hess_row;
+
+    Array<Idx> conflicts;
+    FOREACH(chunk, s->chunks)
+        conflicts.clear();
+        stack.setConflicts(&conflicts);
+        stack.getDataI() = chunk.operands_begin;
+        computeStack(stack, chunk.ops_begin, chunk.ops_end);
+        if (chunk.nof_terms > 1)
+            stack.doAdd(chunk.nof_terms);
+        ASSERT_EQ(stack.size(), 1);
+
+        chunk.conflicts_begin = s->conflicts.size();
+        for (Idx i=0; i<conflicts.size(); i++)
+            s->conflicts.push_back(conflicts[i]);
+        const auto jac_entries = stack.getJacEntries();
+        const auto hess_entries = stack.getHessEntries();
+        chunk.jac_begin = jac_row.size();
+        FOREACH(var, jac_entries)
+            ASSERT(jac_pos.count(var));
+            jac_row.push_back(jac_pos[var]);
+        }
+        chunk.hess_begin = hess_row.size();
+        FOREACH(p, hess_entries)
+            ASSERT(hess_pos.count(p));
+            hess_row.push_back(hess_pos[p]);
+        }
+        stack.clear();
+    }
+    s->jac.resize(jac_row.size());
+    s->hess.resize(hess_row.size());
+
+    // invert jac_row and hess_row
+    auto sources = [](const vector<Idx>& row, const Idx& n,
+            vector<Idx>& begin, vector<Idx>& src){
+        begin.assign(n + 1, 0);
+        FOREACH(r, row)
+            begin[r+1]++;
+        }
+        for (Idx i=0; i<n; i++)
+            begin[i+1] += begin[i];
+        src.resize(row.size());
+        vector<Idx> next(begin.begin(), begin.end() - 1);
+        for (Idx k=0; k<row.size(); k++)
+            src[next[row[k]]++] = k;
+    };
+    sources(jac_row, analysis->jac_entries.size(), s->jac_src_begin,
+            s->jac_src);
+    sources(hess_row, analysis->hess_entries.size(), s->hess_src_begin,
+            s->hess_src);
+    split = std::move(s);
+    TRACE_END;
+}
+
+void InnerConstraint::mapHess(HessPosMap& hess_pos_map){
+    TRACE_START;
+    ASSERT(not analyzed && analysis != nullptr);
+    auto& idx = arena->idx;
+    const auto& jac_entries = analysis->jac_entries;
+    jac_begin = idx.size();
+    nof_jac = jac_entries.size();
+    idx.append(jac_entries.begin(), jac_entries.end());
+
+    hess_map_begin = idx.size();
+    nof_hess = analysis->hess_entries.size();
+    FOREACH(p, analysis->hess_entries)
+        // only inserts if new
+        auto res = hess_pos_map.insert({p, hess_pos_map.size()});
+        idx.push_back(res.first->second);
+    }
+    hess_values = arena->values.size();
+    arena->values.resize(hess_values + nof_hess);
+
+    const auto& conflicts = analysis->conflicts;
+    conflicts_begin = idx.size();
+    nof_conflicts = conflicts.size();
+    for (Idx i=0; i<conflicts.size(); i++)
+        idx.push_back(conflicts[i]);
+
+    analysis.reset();
+    analyzed = true;
+    TRACE_END;
 }
 
 //InnerConstraint::InnerConstraint(
@@ -131,68 +503,560 @@ void InnerConstraint::ub(double v){
 }
 
 Idx InnerConstraint::getNNZ_Jac(){
-    ASSERT(operators[0] == OP_CONST || !jac.empty());
-    return jac.size(); 
+    ASSERT(analyzed);
+    return nof_jac; 
 }
 
-const vector<Idx>& InnerConstraint::getJacEntries(){ 
-    return jac_entries;
+vector<Idx> InnerConstraint::getJacEntries()const{ 
+    auto begin = arena->idx.begin() + jac_begin;
+    return vector<Idx>(begin, begin + nof_jac);
 }
 
-void InnerConstraint::getNZ_Jac(unsigned int* jCol){
-    Idx data_i = 0;
-    FOREACH(id, jac_entries)
-    //for (auto id : jac_entries){
-        jCol[data_i++] = id;
+Idx InnerConstraint::tapeSize()const{
+    return tape_size;
+}
+
+Idx InnerConstraint::getNNZ_Hess()const{
+    return nof_hess;
+}
+
+Idx InnerConstraint::nofConflicts()const{
+    return nof_conflicts;
+}
+
+Idx InnerConstraint::nofChunks()const{
+    return split == nullptr ? 0 : split->chunks.size();
+}
+
+size_t InnerConstraint::memory()const{
+    size_t bytes = sizeof(InnerConstraint) + MadOpt::memory(jac);
+    if (own_arena != nullptr)
+        bytes += own_arena->memory();
+    if (analysis != nullptr)
+        bytes += sizeof(Analysis) + analysis->conflicts.memory()
+            + MadOpt::memory(analysis->jac_entries)
+            + MadOpt::memory(analysis->hess_entries);
+    if (split != nullptr)
+        bytes += sizeof(Split) + MadOpt::memory(split->chunks)
+            + MadOpt::memory(split->conflicts) + MadOpt::memory(split->jac)
+            + MadOpt::memory(split->hess)
+            + MadOpt::memory(split->jac_src_begin)
+            + MadOpt::memory(split->jac_src)
+            + MadOpt::memory(split->hess_src_begin)
+            + MadOpt::memory(split->hess_src);
+    return bytes;
+}
+
+string InnerConstraint::toString(const VarPool& vars)const{
+    return toString(vars, 0, tape_size, 0).first;
+}
+
+std::pair<string, OPType> InnerConstraint::toString(const VarPool& vars,
+        const Idx& begin, const Idx& end, Idx operand)const{
+    // same parentheses as Expr::toString()
+    auto enclosed = [](const std::pair<string, OPType>& e){
+        if (e.second == OP_ADD || e.second == OP_DIV || isPower(e.second))
+            return "(" + e.first + ")";
+        return e.first;
+    };
+    const Idx* operands = arena->operands.data() + operands_begin;
+    const Idx* slots = arena->idx.data() + slots_begin;
+    vector<std::pair<string, OPType>> stack;
+    for (Idx i=begin; i<end; i++){
+        const OPType& type = arena->ops[ops_begin + i];
+        string res;
+        switch(type){
+            case OP_VAR_IDX:
+                res = vars[operands[operand++]]->name();
+                break;
+            case OP_CONST:
+                res = doubleToString(arena->consts[operands[operand++]]);
+                break;
+            case OP_PARAM_POINTER:
+                res = "[" + arena->params[operands[operand++]]->name() + "]";
+                break;
+            case OP_PARAM_SLOT: {
+                const Idx& slot = operands[operand++];
+                stack.push_back(toString(vars, slots[slot], slots[slot+1],
+                            slots[nof_slots+1+slot]));
+                continue;
+            }
+            case OP_ADD:
+            case OP_MUL: {
+                const Idx& n = operands[operand++];
+                ASSERT_LE(n, stack.size());
+                // the tape of an Expr has its operands in reverse order
+                auto first = stack.end() - n;
+                for (auto iter=stack.end(); iter!=first; iter--)
+                    res += (iter == stack.end() ? "" : type == OP_ADD ? "+" : "*")
+                        + enclosed(*(iter-1));
+                stack.erase(first, stack.end());
+                break;
+            }
+            case OP_POW:
+            case OP_IPOW:
+                res = enclosed(stack.back()) + "^"
+                    + doubleToString(arena->consts[operands[operand++]]);
+                stack.pop_back();
+                break;
+            case OP_SQR:
+            case OP_INV:
+            case OP_SQRT:
+                res = enclosed(stack.back()) + "^"
+                    + doubleToString(Operator(type).getExponent());
+                stack.pop_back();
+                break;
+            case OP_DIV:
+                // the divisor is on top
+                res = enclosed(stack.end()[-2]) + "/"
+                    + (stack.back().second == OP_MUL
+                            ? "(" + stack.back().first + ")"
+                            : enclosed(stack.back()));
+                stack.pop_back();
+                stack.pop_back();
+                break;
+            case OP_EXP:
+                res = "exp(" + stack.back().first + ")";
+                stack.pop_back();
+                break;
+            case OP_SIN:
+                res = "sin(" + stack.back().first + ")";
+                stack.pop_back();
+                break;
+            case OP_COS:
+                res = "cos(" + stack.back().first + ")";
+                stack.pop_back();
+                break;
+            case OP_TAN:
+                res = "tan(" + stack.back().first + ")";
+                stack.pop_back();
+                break;
+            case OP_LOG2:
+                res = "log2(" + stack.back().first + ")";
+                stack.pop_back();
+                break;
+            case OP_LN:
+                res = "ln(" + stack.back().first + ")";
+                stack.pop_back();
+                break;
+            default:
+                throw MadOptError("unknown operator on the tape");
+        }
+        stack.emplace_back(res, type);
+    }
+    ASSERT_EQ(stack.size(), 1);
+    return stack.back();
+}
+
+InnerConstraint::TapeStats InnerConstraint::tapeStats(
+        vector<Idx>& op_counts)const{
+    // depth and degree of the sub expressions
+    vector<std::pair<Idx, int>> stack;
+    const Idx* operands = arena->operands.data() + operands_begin;
+    Idx operand = 0;
+    uint64_t shape = 14695981039346656037ULL;
+    auto hash = [&](const uint64_t& v){ shape = (shape ^ v) * 1099511628211ULL; };
+    for (Idx i=0; i<tape_size; i++){
+        const OPType& type = arena->ops[ops_begin + i];
+        if (op_counts.size() <= (Idx)type)
+            op_counts.resize(type + 1, 0);
+        op_counts[type]++;
+        hash(type);
+        switch(type){
+            case OP_VAR_IDX:
+                operand++;
+                stack.emplace_back(1, 1);
+                break;
+            case OP_CONST:
+            case OP_PARAM_POINTER:
+            case OP_PARAM_SLOT:
+                operand++;
+                stack.emplace_back(1, 0);
+                break;
+            case OP_ADD:
+            case OP_MUL: {
+                const Idx& n = operands[operand++];
+                ASSERT_LE(n, stack.size());
+                hash(n);
+                Idx depth = 0;
+                int degree = 0;
+                for (auto iter=stack.end()-n; iter!=stack.end(); iter++){
+                    depth = std::max(depth, iter->first);
+                    if (degree < 0 || iter->second < 0)
+                        degree = -1;
+                    else if (type == OP_ADD)
+                        degree = std::max(degree, iter->second);
+                    else
+                        degree += iter->second;
+                }
+                stack.erase(stack.end()-n, stack.end());
+                stack.emplace_back(depth + 1, degree);
+                break;
+            }
+            case OP_POW:
+            case OP_IPOW:
+            case OP_SQR:
+            case OP_INV:
+            case OP_SQRT: {
+                const double exponent = hasData(type)
+                    ? arena->consts[operands[operand++]]
+                    : Operator(type).getExponent();
+                uint64_t bits;
+                memcpy(&bits, &exponent, sizeof(bits));
+                hash(bits);
+                auto& top = stack.back();
+                top.first++;
+                if (top.second > 0)
+                    top.second = exponent >= 0 && exponent == std::floor(exponent)
+                        ? top.second*exponent : -1;
+                break;
+            }
+            case OP_DIV: {
+                // a constant divisor keeps the degree of the dividend
+                ASSERT_LE(2, stack.size());
+                auto divisor = stack.back();
+                stack.pop_back();
+                auto& top = stack.back();
+                top.first = std::max(top.first, divisor.first) + 1;
+                if (divisor.second != 0)
+                    top.second = -1;
+                break;
+            }
+            case OP_SIN:
+            case OP_COS:
+            case OP_TAN:
+            case OP_LOG2:
+            case OP_LN:
+            case OP_EXP: {
+                auto& top = stack.back();
+                top.first++;
+                if (top.second != 0)
+                    top.second = -1;
+                break;
+            }
+            default:
+                throw MadOptError("unknown operator on the tape");
+        }
     }
+    ASSERT_EQ(stack.size(), 1);
+    return {stack.back().first, stack.back().second, (size_t)shape};
+}
+
+void InnerConstraint::getNZ_Jac(unsigned int* jCol){
+    const Idx* jac_entries = arena->idx.data() + jac_begin;
+    for (Idx i=0; i<nof_jac; i++)
+        jCol[i] = jac_entries[i];
 }
 
 void InnerConstraint::setEvals(CStack& stack){
+    jac.resize(nof_jac);
+    setEvals(stack, jac.data(), nullptr);
+}
+
+void InnerConstraint::setEvals(CStack& stack, double* jac_values, const Idx* jac_map){
     TRACE_START;
+    ASSERT(analyzed);
+    if (nof_slots > 0 && param_changes != arena->paramChanges())
+        updateParamSlots();
+    if (split != nullptr && stack.getPool() != nullptr){
+        evalChunks(stack, jac_values, jac_map);
+        TRACE_END;
+        return;
+    }
     stack.clear();
-    stack.setConflicts(&conflicts);
+    stack.setConflicts(arena->idx.data() + conflicts_begin);
     ASSERT_EQ(stack.size(), 0);
     computeFinalStack(stack);
     ASSERT_EQ(stack.size(), 1);
-    ASSERT_IF(operators.back() != OP_CONST, jac.data() != nullptr);
-    stack.fill(g, jac.data(), hess.data());
+    stack.fill(g, jac_values, arena->values.data() + hess_values, jac_map);
+    VALGRIND_CONDITIONAL_JUMP_TEST(g);
+    TRACE_END;
+}
+
+void InnerConstraint::evalChunks(CStack& stack, double* jac_values,
+        const Idx* jac_map){
+    TRACE_START;
+    Split& s = *split;
+    ThreadPool& pool = *stack.getPool();
+    const double* x = stack.getX();
+    const Idx order = stack.getOrder();
+    auto chunk_evals = [&](size_t task, size_t worker){
+        TIMELINE_SCOPE("evalChunk");
+        Chunk& chunk = s.chunks[task];
+        CStack& ws = stack.getWorker(worker);
+        ws.setX(x);
+        ws.setOrder(order);
+        ws.clear();
+        ws.setConflicts(s.conflicts.data() + chunk.conflicts_begin);
+        ws.getDataI() = chunk.operands_begin;
+        computeStack(ws, chunk.ops_begin, chunk.ops_end);
+        if (chunk.nof_terms > 1)
+            ws.doAdd(chunk.nof_terms);
+        ASSERT_EQ(ws.size(), 1);
+        ws.fill(chunk.g, s.jac.data() + chunk.jac_begin,
+                s.hess.data() + chunk.hess_begin);
+    };
+    pool.run(s.chunks.size(), chunk_evals);
+
+    g = 0;
+    FOREACH(chunk, s.chunks)
+        g += chunk.g;
+    }
     VALGRIND_CONDITIONAL_JUMP_TEST(g);
+
+    // the jacobian entries followed by the hessian entries, split into one
+    // block per worker
+    double* hess = arena->values.data() + hess_values;
+    const Idx nof_jac_entries = order > 0 && jac_values != nullptr ? nof_jac
+        : 0;
+    const Idx nof_entries = nof_jac_entries + (order > 1 ? nof_hess : 0);
+    if (nof_entries == 0){
+        TRACE_END;
+        return;
+    }
+    const size_t nof_blocks = pool.size();
+    auto reduction = [&](size_t block, size_t){
+        const Idx begin = (size_t)nof_entries * block / nof_blocks;
+        const Idx end = (size_t)nof_entries * (block+1) / nof_blocks;
+        for (Idx i=begin; i<end; i++){
+            const bool is_jac = i < nof_jac_entries;
+            const Idx e = is_jac ? i : i - nof_jac_entries;
+            const vector<Idx>& src_begin = is_jac ? s.jac_src_begin
+                : s.hess_src_begin;
+            const vector<Idx>& src = is_jac ? s.jac_src : s.hess_src;
+            const double* values = is_jac ? s.jac.data() : s.hess.data();
+            double sum = 0;
+            for (Idx k=src_begin[e]; k<src_begin[e+1]; k++)
+                sum += values[src[k]];
+            if (not is_jac)
+                hess[e] = sum;
+            else if (jac_map != nullptr)
+                jac_values[jac_map[e]] = sum;
+            else
+                jac_values[e] = sum;
+        }
+    };
+    pool.run(nof_blocks, reduction);
     TRACE_END;
 }
 
+const Idx& InnerConstraint::getNextOperand(Idx& idx){
+    ASSERT_LE(operands_begin + idx, arena->operands.size()-1);
+    return arena->operands[operands_begin + idx++];
+}
+
 const double& InnerConstraint::getNextValue(Idx& idx){
-    ASSERT_LE(idx, data.size()-1);
-    return data[idx++].d;
+    return arena->consts[getNextOperand(idx)];
 }
 
 Idx InnerConstraint::getNextCounter(Idx& idx){
-    ASSERT_LE(idx, data.size()-1);
-    return data[idx++].idx;
+    return getNextOperand(idx);
 }
 
 const Idx& InnerConstraint::getNextPos(Idx& idx){
-    ASSERT_LE(idx, data.size()-1);
-    return (data[idx++].iVar)->getPos();
+    return getNextOperand(idx);
 }
 
 const double& InnerConstraint::getNextParamValue(Idx& idx){
-    ASSERT_LE(idx, data.size()-1);
-    return (data[idx++].iParam)->value();
+    return arena->params[getNextOperand(idx)]->value();
+}
+
+bool InnerConstraint::hasData(const OPType& type){
+    return type == OP_VAR_POINTER
+        || type == OP_ADD
+        || type == OP_MUL
+        || type == OP_POW
+        || type == OP_IPOW
+        || type == OP_CONST
+        || type == OP_VAR_IDX
+        || type == OP_PARAM_POINTER
+        || type == OP_PARAM_SLOT;
+}
+
+void InnerConstraint::hoistParamExprs(vector<OPType>& operators,
+        vector<Value>& data, vector<Idx>& slot_ops, vector<Idx>& slot_data){
+    TRACE_START;
+    // find the maximal sub expressions that depend on parameters and
+    // constants only, hoist_end[i] is the last operator of the one starting
+    // at operator i
+    struct Node {
+        Idx op_start;
+        Idx op_end;
+        bool params_only;
+        bool has_param;
+    };
+    const Idx none = operators.size();
+    vector<Idx> hoist_end(operators.size(), none);
+    auto hoist = [&](const Node& n){
+        if (n.params_only && n.has_param && n.op_start < n.op_end)
+            hoist_end[n.op_start] = n.op_end;
+    };
+
+    vector<Node> nodes;
+    Idx data_i = 0;
+    for (Idx i=0; i<operators.size(); i++){
+        const auto& type = operators[i];
+        Node node = {i, i, type != OP_VAR_POINTER && type != OP_VAR_IDX,
+            type == OP_PARAM_POINTER};
+        Idx nof_children = 0;
+        if (type == OP_ADD || type == OP_MUL)
+            nof_children = data[data_i].idx;
+        else if (type == OP_DIV)
+            nof_children = 2;
+        else if (type != OP_VAR_POINTER && type != OP_VAR_IDX
+                && type != OP_CONST && type != OP_PARAM_POINTER)
+            nof_children = 1;
+        if (hasData(type))
+            data_i++;
+
+        ASSERT_LE(nof_children, nodes.size());
+        auto first = nodes.end() - nof_children;
+        for (auto iter=first; iter!=nodes.end(); iter++){
+            node.params_only = node.params_only && iter->params_only;
+            node.has_param = node.has_param || iter->has_param;
+        }
+        if (nof_children > 0)
+            node.op_start = first->op_start;
+        if (not node.params_only)
+            for (auto iter=first; iter!=nodes.end(); iter++)
+                hoist(*iter);
+        nodes.erase(first, nodes.end());
+        nodes.push_back(node);
+    }
+    ASSERT_EQ(nodes.size(), 1);
+    hoist(nodes.back());
+
+    // move them behind the tape and replace them by slots
+    vector<OPType> tape_ops;
+    vector<Value> tape_data;
+    vector<OPType> param_ops;
+    vector<Value> param_data;
+    data_i = 0;
+    for (Idx i=0; i<operators.size(); i++){
+        if (hoist_end[i] == none){
+            tape_ops.push_back(operators[i]);
+            if (hasData(operators[i]))
+                tape_data.push_back(data[data_i++]);
+            continue;
+        }
+        tape_ops.push_back(OP_PARAM_SLOT);
+        tape_data.push_back(Value((Idx) slot_ops.size()));
+        slot_ops.push_back(param_ops.size());
+        slot_data.push_back(param_data.size());
+        for (Idx k=i; k<=hoist_end[i]; k++){
+            param_ops.push_back(operators[k]);
+            if (hasData(operators[k]))
+                param_data.push_back(data[data_i++]);
+        }
+        i = hoist_end[i];
+    }
+    slot_ops.push_back(param_ops.size());
+
+    tape_size = tape_ops.size();
+    FOREACH(pos, slot_ops)
+        pos += tape_size;
+    }
+    FOREACH(pos, slot_data)
+        pos += tape_data.size();
+    }
+    tape_ops.insert(tape_ops.end(), param_ops.begin(), param_ops.end());
+    tape_data.insert(tape_data.end(), param_data.begin(), param_data.end());
+    operators.swap(tape_ops);
+    data.swap(tape_data);
+    TRACE_END;
+}
+
+void InnerConstraint::compile(const vector<OPType>& operators,
+        const vector<Value>& data, const vector<Idx>& slot_ops,
+        const vector<Idx>& slot_data){
+    TRACE_START;
+    ops_begin = arena->ops.size();
+    operands_begin = arena->operands.size();
+    Idx data_i = 0;
+    FOREACH(type, operators)
+        if (not hasData(type)){
+            arena->ops.push_back(type);
+            continue;
+        }
+        const Value& value = data[data_i++];
+        switch(type){
+            case OP_VAR_POINTER:
+                arena->ops.push_back(OP_VAR_IDX);
+                arena->operands.push_back(value.iVar->getPos());
+                continue;
+            case OP_CONST:
+            case OP_POW:
+            case OP_IPOW:
+                arena->operands.push_back(arena->consts.size());
+                arena->consts.push_back(value.d);
+                break;
+            case OP_PARAM_POINTER:
+                ASSERT(arena->param_pool == nullptr
+                        || arena->param_pool == &value.iParam->getPool(),
+                        "params of different models in one arena");
+                arena->param_pool = &value.iParam->getPool();
+                arena->operands.push_back(arena->params.size());
+                arena->params.push_back(value.iParam);
+                break;
+            default:
+                arena->operands.push_back(value.idx);
+        }
+        arena->ops.push_back(type);
+    }
+    ASSERT_EQ(data_i, data.size());
+
+    nof_slots = slot_data.size();
+    slots_begin = arena->idx.size();
+    arena->idx.append(slot_ops.begin(), slot_ops.end());
+    arena->idx.append(slot_data.begin(), slot_data.end());
+    slot_values = arena->values.size();
+    arena->values.resize(slot_values + nof_slots);
+    TRACE_END;
+}
+
+void InnerConstraint::updateParamSlots(){
+    TRACE_START;
+    ParamStack stack;
+    const Idx* slot_ops = arena->idx.data() + slots_begin;
+    const Idx* slot_data = slot_ops + nof_slots + 1;
+    for (Idx i=0; i<nof_slots; i++){
+        stack.clear();
+        stack.getDataI() = slot_data[i];
+        computeStack(stack, slot_ops[i], slot_ops[i+1]);
+        ASSERT_EQ(stack.size(), 1);
+        arena->values[slot_values + i] = stack.lastG();
+    }
+    param_changes = arena->paramChanges();
+    TRACE_END;
 }
 
-#define MADOPTCASE(a) case OP_##a: case##a(stack); break;
 void InnerConstraint::computeFinalStack(Stack& stack){
     TRACE_START;
     ASSERT_EQ(stack.getDataI(), 0);
-    FOREACH(op, operators)
-    //for (auto& op: operators){
-        switch(op){
-            MADOPTCASE(VAR_POINTER)
+    computeStack(stack, 0, tape_size);
+    TRACE_END;
+}
+
+#define MADOPTCASE(a) case OP_##a: case##a(stack); break;
+void InnerConstraint::computeStack(Stack& stack, const Idx& begin,
+        const Idx& end){
+    TRACE_START;
+    const OPType* ops = arena->ops.data() + ops_begin;
+    for (Idx i=begin; i<end; i++){
+        switch(ops[i]){
+            MADOPTCASE(VAR_IDX)
             MADOPTCASE(CONST)
             MADOPTCASE(ADD)
             MADOPTCASE(MUL)
             MADOPTCASE(POW)
+            MADOPTCASE(IPOW)
+            MADOPTCASE(SQR)
+            MADOPTCASE(INV)
+            MADOPTCASE(SQRT)
+            MADOPTCASE(EXP)
+            MADOPTCASE(DIV)
             MADOPTCASE(PARAM_POINTER)
+            MADOPTCASE(PARAM_SLOT)
             MADOPTCASE(SIN)
             MADOPTCASE(COS)
             MADOPTCASE(TAN)
@@ -216,13 +1080,12 @@ void InnerConstraint::caseADD(Stack& stack){
 void InnerConstraint::caseMUL(Stack& stack){
    TRACE_START;
    const auto& size = getNextCounter(stack.getDataI());
-   for (Idx i=0; i<size-1; i++){
-       stack.doMull();
-   }
+   if (size > 1)
+       stack.doMull(size);
    TRACE_END;
 }
 
-void InnerConstraint::caseVAR_POINTER(Stack& stack){
+void InnerConstraint::caseVAR_IDX(Stack& stack){
     TRACE_START;
     const auto& pos = getNextPos(stack.getDataI());
     stack.emplace_back(pos);
@@ -235,6 +1098,13 @@ void InnerConstraint::casePARAM_POINTER(Stack& stack){
     TRACE_END;
 }
 
+void InnerConstraint::casePARAM_SLOT(Stack& stack){
+    TRACE_START;
+    stack.emplace_back(arena->values[slot_values
+            + getNextCounter(stack.getDataI())]);
+    TRACE_END;
+}
+
 void InnerConstraint::caseCONST(Stack& stack){
    TRACE_START;
     stack.emplace_back(getNextValue(stack.getDataI()));
@@ -255,6 +1125,83 @@ void InnerConstraint::casePOW(Stack& stack){
    TRACE_END;
 }
 
+//! b^n by repeated squaring
+static double ipow(double b, long n){
+    if (n < 0)
+        return 1 / ipow(b, -n);
+    double res = 1;
+    while (n > 0){
+        if (n & 1)
+            res *= b;
+        b *= b;
+        n >>= 1;
+    }
+    return res;
+}
+
+void InnerConstraint::caseIPOW(Stack& stack){
+   TRACE_START;
+    const long n = (long) getNextValue(stack.getDataI());
+    double& g = stack.lastG();
+    // ipow(g, n-2) is inf at g=0
+    if (n == 0 || n == 1){
+        g = n == 0 ? 1 : g;
+        stack.doUnaryOp(n, 0);
+        return;
+    }
+    double pow_hess = ipow(g, n-2);
+    double hess = pow_hess * n * (n-1);
+    double jac = pow_hess * g * n;
+    g = pow_hess * g * g;
+    stack.doUnaryOp(jac, hess);
+   TRACE_END;
+}
+
+void InnerConstraint::caseSQR(Stack& stack){
+   TRACE_START;
+    double& g = stack.lastG();
+    double jac = 2 * g;
+    g *= g;
+    stack.doUnaryOp(jac, 2);
+   TRACE_END;
+}
+
+void InnerConstraint::caseINV(Stack& stack){
+   TRACE_START;
+    double& g = stack.lastG();
+    double inv = 1 / g;
+    g = inv;
+    stack.doUnaryOp(-inv * inv, 2 * inv * inv * inv);
+   TRACE_END;
+}
+
+void InnerConstraint::caseSQRT(Stack& stack){
+   TRACE_START;
+    double& g = stack.lastG();
+    double root = std::sqrt(g);
+    double jac = 0.5 / root;
+    double hess = -0.5 * jac / g;
+    g = root;
+    stack.doUnaryOp(jac, hess);
+   TRACE_END;
+}
+
+void InnerConstraint::caseEXP(Stack& stack){
+   TRACE_START;
+    double& g = stack.lastG();
+    g = std::exp(g);
+    stack.doUnaryOp(g, g);
+   TRACE_END;
+}
+
+void InnerConstraint::caseDIV(Stack& stack){
+   TRACE_START;
+    // the divisor is on top
+    caseINV(stack);
+    stack.doMull(2);
+   TRACE_END;
+}
+
 void InnerConstraint::caseSIN(Stack& stack){
    TRACE_START;
     double& g = stack.lastG();
@@ -18,9 +18,11 @@
 
 #include <set>
 #include <vector>
+#include <memory>
 #include "common.hpp"
 #include "array.hpp"
 #include "constraint_interface.hpp"
+#include "constraint_arena.hpp"
 #include "value.hpp"
 
 namespace MadOpt {
@@ -31,11 +33,99 @@ typedef char OPType;
 class Stack;
 class CStack;
 class SimStack;
+class VarPool;
 
 class InnerConstraint: public ConstraintInterface{
     public:
+        //! the data is stored in arena, or in an arena of its own if it is
+        //nullptr
         InnerConstraint(const Expr& expr, const double _lb, const double _ub,
-                HessPosMap& hess_pos_map, SimStack& stack);
+                HessPosMap& hess_pos_map, SimStack& stack,
+                ConstraintArena* arena=nullptr);
+
+        //! builds the tape only, analyze() and mapHess() have to be called
+        //before the constraint can be evaluated
+        InnerConstraint(const Expr& expr, const double _lb, const double _ub,
+                ConstraintArena* arena=nullptr);
+
+        //! operators in postfix order and the data of those that have some,
+        //variables are OP_VAR_IDX operators with their position as data
+        struct Tape {
+            vector<OPType> ops;
+            vector<Value> data;
+        };
+
+        //! \sa InnerConstraint(const Expr&, const double, const double,
+        //ConstraintArena*)
+        InnerConstraint(Tape tape, const double _lb, const double _ub,
+                ConstraintArena* arena=nullptr);
+
+        //! true if operators of type carry data on the tape
+        static bool hasData(const OPType& type);
+
+        //! position of the data of an analyzed constraint in its arena and
+        //its bounds, \sa Model::save()
+        struct Layout {
+            Idx ops_begin;
+            Idx operands_begin;
+            Idx tape_size;
+            Idx slots_begin;
+            Idx nof_slots;
+            Idx slot_values;
+            Idx jac_begin;
+            Idx nof_jac;
+            Idx hess_map_begin;
+            Idx hess_values;
+            Idx nof_hess;
+            Idx conflicts_begin;
+            Idx nof_conflicts;
+            //! 0, the explicit padding keeps snapshots free of
+            //uninitialised bytes
+            Idx padding;
+            double lb;
+            double ub;
+        };
+
+        //! constraint that is already compiled and analyzed in arena, or in
+        //an arena of its own if it is nullptr, \sa Model::load()
+        InnerConstraint(const Layout& layout, ConstraintArena* arena=nullptr);
+
+        Layout layout()const;
+
+        //! true if the ranges of layout are within arena
+        static bool fits(const Layout& layout, const ConstraintArena& arena);
+
+        /*! \brief checks the data of a constraint loaded from a Layout that
+         * fits its arena
+         * \details the operands have to refer to variables below nx and to
+         * the constants, params and slots of the arena, the tape and the
+         * slot tapes have to leave one value, the jacobian entries have to
+         * be variables and the hessian map positions below nof_hess_pos.
+         * The conflicts are replayed by a CheckStack, a sweep has to fit
+         * into a CStack resized to max_g, max_jac and max_hess. The sizes
+         * the sweep needs are raised in sizes.
+         * @return false if anything does not hold
+         */
+        bool check(const Idx& nx, const Idx& nof_hess_pos, const Idx& max_g,
+                const Idx& max_jac, const Idx& max_hess, SimStack& sizes);
+
+        ConstraintArena& getArena(){ return *arena; }
+
+        /*! \brief symbolic pass computing the jacobian and hessian
+         * structure, does not touch the arena
+         * \details a sum at the root with at least 2*chunk_terms terms is
+         * also split into up to max_chunks chunks of consecutive terms, with
+         * at least chunk_terms terms each. setEvals() evaluates the chunks
+         * in parallel if the stack has a pool. Constraints loaded from a
+         * Layout are not split.
+         */
+        void analyze(SimStack& stack, const Idx& max_chunks=1,
+                const Idx& chunk_terms=1);
+
+        //! assigns the hessian entries found by analyze() to their position
+        //in hess_pos_map, new entries are appended, and moves the results of
+        //analyze() into the arena
+        void mapHess(HessPosMap& hess_pos_map);
 
         //InnerConstraint(const Expr& expr, HessPosMap& hess_pos_map, SimStack& stack);
 
@@ -62,36 +152,169 @@ class InnerConstraint: public ConstraintInterface{
         //
         void setEvals(CStack&);
 
+        void setEvals(CStack& stack, double* jac, const Idx* jac_map);
+
         // access next points solution
         //
         //
         const double& getG()const ;
 
+        //! jacobian of the last setEvals(CStack&) call
         const vector<double>& getJac()const ;
 
         void eval_h(double* values, const double& lambda);
 
+        // caching
+        //
+        //
+        Idx evalsSize()const;
+
+        void saveEvals(double* data)const;
+
+        void loadEvals(const double* data);
+
         // for debug and testing
         //
         //
-        const vector<double>& getHess()const ;
+        vector<double> getHess()const ;
+
+        vector<Idx> getHessMap()const;
 
-        const vector<Idx>& getHessMap()const;
+        vector<Idx> getJacEntries()const;
 
-        const vector<Idx>& getJacEntries();
+        // profiling
+        //
+        //
+        //! number of operators on the tape, the hoisted parameter
+        //expressions excluded
+        Idx tapeSize()const;
+
+        Idx getNNZ_Hess()const;
+
+        //! length of the conflict list the hessian sweep reads
+        Idx nofConflicts()const;
+
+        //! number of chunks the root sum is split into, 0 if it is not split
+        Idx nofChunks()const;
+
+        //! bytes allocated by the constraint, its own arena included
+        size_t memory()const;
+
+        //! the expression of the tape, variables are named by vars
+        string toString(const VarPool& vars)const;
+
+        //! structure of the tape, \sa Model::analyze()
+        struct TapeStats {
+            //! depth of the expression tree
+            Idx depth;
+            //! polynomial degree, -1 if the expression is no polynomial,
+            //parameters count as constants
+            int degree;
+            //! hash of the operators, equal for tapes that only differ in
+            //their variables, constants and parameters
+            size_t shape;
+        };
+
+        /*! \brief structure of the tape
+         * \details adds the number of operators per type to op_counts,
+         * which is indexed by OPType, a hoisted parameter expression counts
+         * as one OP_PARAM_SLOT
+         */
+        TapeStats tapeStats(vector<Idx>& op_counts)const;
 
     private:
+        //! jacobian of the last setEvals(CStack&) call
         vector<double> jac;
 
-        vector<double> hess;
+        //! results of analyze() until mapHess() moves them into the arena
+        struct Analysis {
+            Array<Idx> conflicts;
+            vector<Idx> jac_entries;
+            vector<PII> hess_entries;
+        };
+
+        std::unique_ptr<Analysis> analysis;
+
+        //! terms first_term to first_term+nof_terms-1 of the root sum, they
+        //are the operators ops_begin to ops_end-1 of the tape with their
+        //operands starting at operands_begin
+        struct Chunk {
+            Idx ops_begin;
+            Idx ops_end;
+            Idx operands_begin;
+            Idx nof_terms;
+            //! position in Split::conflicts
+            Idx conflicts_begin;
+            //! position of its values in Split::jac and Split::hess
+            Idx jac_begin;
+            Idx hess_begin;
+            //! value of the last evaluation
+            double g;
+        };
+
+        //! the root sum split into chunks, \sa analyze()
+        struct Split {
+            vector<Chunk> chunks;
+            vector<Idx> conflicts;
+            //! jacobian and hessian values of the chunks
+            vector<double> jac;
+            vector<double> hess;
+            //! jacobian entry i of the constraint is the sum of
+            //jac[jac_src[k]] for k from jac_src_begin[i] to
+            //jac_src_begin[i+1]-1, the same for the hessian
+            vector<Idx> jac_src_begin;
+            vector<Idx> jac_src;
+            vector<Idx> hess_src_begin;
+            vector<Idx> hess_src;
+        };
+
+        std::unique_ptr<Split> split;
+
+        std::unique_ptr<ConstraintArena> own_arena;
+
+        ConstraintArena* arena;
+
+        //! the tape consists of tape_size operators starting at ops_begin,
+        //followed by the parameter only sub expressions, the operands start
+        //at operands_begin
+        Idx ops_begin;
+
+        Idx operands_begin;
+
+        Idx tape_size;
+
+        //! slot i is computed from the operators arena->idx[slots_begin+i]
+        //to arena->idx[slots_begin+i+1]-1 with the operands starting at
+        //arena->idx[slots_begin+nof_slots+1+i], all relative to the tape,
+        //its value is arena->values[slot_values+i]
+        Idx slots_begin;
 
-        vector<Idx> hess_map;
+        Idx nof_slots;
 
-        vector<Idx> jac_entries;
+        Idx slot_values;
 
-        vector<OPType> operators;
+        //! jacobian entries at arena->idx[jac_begin]
+        Idx jac_begin;
 
-        vector<Value> data;
+        Idx nof_jac;
+
+        //! hessian map at arena->idx[hess_map_begin], the hessian values at
+        //arena->values[hess_values]
+        Idx hess_map_begin;
+
+        Idx hess_values;
+
+        Idx nof_hess;
+
+        Idx conflicts_begin;
+
+        Idx nof_conflicts;
+
+        bool analyzed;
+
+        //! ConstraintArena::paramChanges() at the last update of the param
+        //slots
+        size_t param_changes;
 
         double g;
 
@@ -99,7 +322,7 @@ class InnerConstraint: public ConstraintInterface{
 
         double _ub;
 
-        Array<Idx> conflicts;
+        inline const Idx& getNextOperand(Idx& idx);
 
         inline const double& getNextValue(Idx& idx); 
 
@@ -111,9 +334,36 @@ class InnerConstraint: public ConstraintInterface{
 
         void computeFinalStack(Stack&);
 
-        void caseVAR_POINTER(Stack&);
+        void computeStack(Stack& stack, const Idx& begin, const Idx& end);
+
+        //! true if the operators in [begin, end) with operands from data_i
+        //on are valid and leave one value, slot tapes cannot refer to
+        //variables or slots, \sa check()
+        bool checkOps(const Idx& begin, const Idx& end, Idx data_i,
+                const Idx& nx, const bool& slot)const;
+
+        //! analyzes the chunks of the root sum, called by analyze() after
+        //the whole tape is analyzed
+        void splitSum(SimStack& stack, const Idx& max_chunks,
+                const Idx& chunk_terms);
+
+        //! setEvals() of a split sum
+        void evalChunks(CStack& stack, double* jac_values, const Idx* jac_map);
+
+        //! the expression of the operators begin to end-1 of the tape with
+        //their operands starting at operand, and the type of its root
+        std::pair<string, OPType> toString(const VarPool& vars,
+                const Idx& begin, const Idx& end, Idx operand)const;
 
-        void caseSQR_VAR(Stack&);
+        void hoistParamExprs(vector<OPType>& operators, vector<Value>& data,
+                vector<Idx>& slot_ops, vector<Idx>& slot_data);
+
+        void compile(const vector<OPType>& operators, const vector<Value>& data,
+                const vector<Idx>& slot_ops, const vector<Idx>& slot_data);
+
+        void updateParamSlots();
+
+        void caseVAR_IDX(Stack&);
 
         void caseADD(Stack&);
 
@@ -121,10 +371,24 @@ class InnerConstraint: public ConstraintInterface{
 
         void casePARAM_POINTER(Stack&);
 
+        void casePARAM_SLOT(Stack&);
+
         void caseCONST(Stack&);
 
         void casePOW(Stack&);
 
+        void caseIPOW(Stack&);
+
+        void caseSQR(Stack&);
+
+        void caseINV(Stack&);
+
+        void caseSQRT(Stack&);
+
+        void caseEXP(Stack&);
+
+        void caseDIV(Stack&);
+
         void caseSIN(Stack&);
 
         void caseCOS(Stack&);
@@ -16,22 +16,128 @@
 #ifndef MADOPT_INNER_PARAM_H
 #define MADOPT_INNER_PARAM_H
 
+#include <deque>
+#include <unordered_map>
+#include "common.hpp"
+#include "snapshot.hpp"
+
 namespace MadOpt {
 
+class ParamPool;
+
 class InnerParam{
     public:
-        InnerParam(const double v, const string& n): _value(v), _name(n){}
+        InnerParam(const double v, const Idx& idx, ParamPool& pool):
+            _value(v), idx(idx), pool(&pool){}
 
-        void value(const double v){ _value = v; }
+        //! sets the value and counts the change in the pool
+        void value(const double v);
 
         const double& value()const { return _value; }
 
-        string name()const { return _name;}
+        string name()const;
+
+        const Idx& getIdx()const { return idx; }
+
+        //! the pool of the model the parameter belongs to
+        const ParamPool& getPool()const { return *pool; }
 
     private:
         double _value;
-        string _name;
+        Idx idx;
+        ParamPool* pool;
+
+        friend class ParamPool;
+};
+
+//! stores the parameters of a model, \sa VarPool
+class ParamPool{
+    public:
+        ParamPool(): nof_changes(0){}
+
+        InnerParam* add(const double v, const string& name){
+            if (not name.empty())
+                names[params.size()] = name;
+            params.emplace_back(v, params.size(), *this);
+            return &params.back();
+        }
+
+        Idx size()const { return params.size(); }
+
+        InnerParam* operator[](const Idx& idx){ return &params[idx]; }
+
+        //! writes the values and names to a snapshot, \sa Model::save()
+        void save(SnapshotWriter& out)const {
+            vector<double> values;
+            FOREACH(p, params)
+                values.push_back(p.value());
+            }
+            out.array(values);
+            out.names(names);
+        }
+
+        //! replaces the parameters by the ones of a snapshot
+        void load(SnapshotReader& in){
+            size_t n;
+            const double* values = in.array<double>(n);
+            params.clear();
+            for (Idx i=0; i<n; i++)
+                params.emplace_back(values[i], i, *this);
+            in.names(names);
+            nof_changes++;
+        }
+
+        /*! \brief counts the value changes of the parameters of this pool
+         * \details the evaluations of the model are outdated if the count
+         * differs from the one of the last evaluation
+         */
+        size_t changes()const { return nof_changes; }
+
+        /*! \brief exchanges the parameters with the ones of other
+         * \details the InnerParams keep their address and move to the
+         * other pool, both pools count a change
+         */
+        void swap(ParamPool& other){
+            params.swap(other.params);
+            names.swap(other.names);
+            FOREACH(p, params)
+                p.pool = this;
+            }
+            FOREACH(p, other.params)
+                p.pool = &other;
+            }
+            nof_changes++;
+            other.nof_changes++;
+        }
+
+        string name(const Idx& idx)const {
+            auto iter = names.find(idx);
+            if (iter != names.end())
+                return iter->second;
+            return "p" + to_string(idx);
+        }
+
+        //! bytes allocated by the parameters and names
+        size_t memory()const {
+            return params.size()*sizeof(InnerParam) + MadOpt::memory(names);
+        }
+
+    private:
+        std::deque<InnerParam> params;
+        std::unordered_map<Idx, string> names;
+        size_t nof_changes;
+
+        friend class InnerParam;
 };
 
+inline void InnerParam::value(const double v){
+    _value = v;
+    pool->nof_changes++;
+}
+
+inline string InnerParam::name()const {
+    return pool->name(idx);
+}
+
 }
 #endif
@@ -18,125 +18,186 @@
 #include "exceptions.hpp"
 #include "solution.hpp"
 #include "common.hpp"
+#include "snapshot.hpp"
 #include <cmath>
 
 namespace MadOpt {
 
-InnerVar::InnerVar(double _lb, 
-        double _ub, 
-        double xi, 
-        VarType type, 
-        string name, 
-        const Solution& sol):
-        pos(-1), 
-        _ub(_ub), 
-        _lb(_lb), 
-        xi(xi), 
-        _name(name), 
-        type(type), 
-        sol(sol), 
-	is_fixed(false){
-            checkBounds();
-        }
+//! returns why the bounds are invalid or nullptr if they are valid
+static const char* boundsError(const double& lb, const double& ub,
+        const double& init){
+    if (lb > ub)
+        return "lb larger than ub for variable ";
+    if (lb > init || ub < init)
+        return "init not in bounds var ";
+    return nullptr;
+}
+
+InnerVar* VarPool::add(double lb, double ub, double init, VarType type,
+        const string& name){
+    Idx pos = vars.size();
+    auto error = boundsError(lb, ub, init);
+    if (error != nullptr)
+        throw MadOptError(error + (name.empty() ? this->name(pos) : name));
+    if (not name.empty())
+        names[pos] = name;
+    lbs.push_back(lb);
+    ubs.push_back(ub);
+    inits.push_back(init);
+    types.push_back(type);
+    is_fixed.push_back(false);
+    vars.emplace_back(*this, pos);
+    return &vars.back();
+}
+
+void VarPool::save(SnapshotWriter& out)const {
+    out.array(lbs);
+    out.array(ubs);
+    out.array(inits);
+    out.array(types);
+    out.array(is_fixed);
+    out.names(names);
+}
+
+void VarPool::load(SnapshotReader& in){
+    in.array(lbs);
+    in.array(ubs);
+    in.array(inits);
+    in.array(types);
+    in.array(is_fixed);
+    in.names(names);
+    if (ubs.size() != lbs.size() || inits.size() != lbs.size()
+            || types.size() != lbs.size() || is_fixed.size() != lbs.size())
+        throw MadOptError("inconsistent variables in snapshot");
+    vars.clear();
+    for (Idx pos=0; pos<lbs.size(); pos++)
+        vars.emplace_back(*this, pos);
+}
+
+void VarPool::swap(VarPool& other){
+    lbs.swap(other.lbs);
+    ubs.swap(other.ubs);
+    inits.swap(other.inits);
+    types.swap(other.types);
+    is_fixed.swap(other.is_fixed);
+    names.swap(other.names);
+    vars.clear();
+    for (Idx pos=0; pos<lbs.size(); pos++)
+        vars.emplace_back(*this, pos);
+    other.vars.clear();
+    for (Idx pos=0; pos<other.lbs.size(); pos++)
+        other.vars.emplace_back(other, pos);
+}
+
+size_t VarPool::memory()const {
+    return vars.size()*sizeof(InnerVar) + MadOpt::memory(lbs)
+        + MadOpt::memory(ubs) + MadOpt::memory(inits) + MadOpt::memory(types)
+        + MadOpt::memory(is_fixed) + MadOpt::memory(names);
+}
+
+string VarPool::name(const Idx& pos)const {
+    auto iter = names.find(pos);
+    if (iter != names.end())
+        return iter->second;
+    return "v" + to_string(pos);
+}
+
+void VarPool::checkBounds(const Idx& pos)const {
+    auto error = boundsError(lbs[pos], ubs[pos], inits[pos]);
+    if (error != nullptr)
+        throw MadOptError(error + name(pos));
+}
 
 bool InnerVar::isActive(){ 
     return true; 
 }
 
 string InnerVar::name()const {
-    return _name;
+    return pool.name(pos);
 }
 
 VarType InnerVar::getType()const {
-    return type;
+    return pool.types[pos];
 }
 
 const Idx& InnerVar::getPos()const {
     return pos; 
 }
 
-void InnerVar::setPos(Idx epos){
-    pos = epos; 
-}
-
 double InnerVar::lb()const {
-    if (is_fixed) return xi;
-    return _lb;
+    if (pool.is_fixed[pos]) return pool.inits[pos];
+    return pool.lbs[pos];
 }
 
 double InnerVar::ub()const {
-    if (is_fixed) return xi;
-    return _ub;
+    if (pool.is_fixed[pos]) return pool.inits[pos];
+    return pool.ubs[pos];
 }
 
 void InnerVar::lb(double l){
-    _lb=l; checkBounds(); 
+    pool.lbs[pos] = l;
+    pool.checkBounds(pos); 
 }
 
 void InnerVar::ub(double u){
-    _ub=u; checkBounds(); 
+    pool.ubs[pos] = u;
+    pool.checkBounds(pos); 
 }
 
 double InnerVar::init()const {
-    return xi;
+    return pool.inits[pos];
 }
 
 void InnerVar::init(double v){
-    xi=v;
-    checkBounds(); 
+    pool.inits[pos] = v;
+    pool.checkBounds(pos); 
 }
 
 double InnerVar::x()const {
-    return sol.x(pos); 
+    return pool.sol.x(pos); 
 }
 
 double InnerVar::v()const {
-    return sol.v(pos); 
+    return pool.sol.v(pos); 
 }
 
 void InnerVar::solAsInit(){
-    xi = x(); 
+    pool.inits[pos] = x(); 
 }
 
 void InnerVar::fixed(bool s){
-    is_fixed=s; 
+    pool.is_fixed[pos] = s; 
 }
 
 bool InnerVar::fixed()const {
-    return is_fixed; 
+    return pool.is_fixed[pos]; 
 }
 
 const Solution& InnerVar::getSolution()const {
-    return sol; 
+    return pool.sol; 
 }
 
 const string InnerVar::toString()const {
     string st;
-    if (type != VarType::CONTINUOUS)
+    if (getType() != VarType::CONTINUOUS)
         st = ":I";
 
+    const double& _lb = pool.lbs[pos];
     string lbstr = to_string(_lb);
     if (_lb == -INF)
         lbstr = "-INF";
 
+    const double& _ub = pool.ubs[pos];
     string ubstr = to_string(_ub);
     if (_ub == INF)
         ubstr = "INF";
 
     return "" 
         + lbstr + "<" 
-        + _name 
+        + name() 
         + st
-        + "=" + to_string(xi) 
+        + "=" + to_string(init()) 
         + "<" + ubstr;
 }
 
-void InnerVar::checkBounds(){
-    if (_lb > _ub)
-        throw MadOptError("lb larger than ub for variable " + _name);
-    if (_lb > xi || _ub < xi)
-        throw MadOptError("init not in bounds var " + _name);
-}
-
-
 }
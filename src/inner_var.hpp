@@ -16,26 +16,26 @@
 #ifndef MADOPT_INNER_VAR_H
 #define MADOPT_INNER_VAR_H
 
+#include <deque>
+#include <unordered_map>
 #include "common.hpp"
 
 namespace MadOpt {
 
 class Solution;
+class VarPool;
+class SnapshotWriter;
+class SnapshotReader;
 
+//! handle of a variable, its data is stored in the columns of a VarPool
 class InnerVar{
     public:
-        InnerVar(double _lb, 
-                double _ub, 
-                double xi,
-                VarType type,
-                string name,
-                const Solution& sol);
+        InnerVar(VarPool& pool, const Idx& pos): pool(pool), pos(pos){}
 
         bool isActive();
         string name()const ;
         VarType getType()const ;
         const Idx& getPos()const ;
-        void setPos(Idx epos);
 
         double lb()const ;
 
@@ -60,17 +60,56 @@ class InnerVar{
         const string toString()const ;
 
     private:
+        VarPool& pool;
         Idx pos;
-        double _ub;
-        double _lb;
-        double xi;
-        const string _name;
-        VarType type;
+};
+
+/*! \brief stores the variables of a model column wise
+ * \details the InnerVar handles are allocated in chunks and keep their
+ * address, names are only stored if given, otherwise they are generated from
+ * the position
+ */
+class VarPool{
+    public:
+        VarPool(const Solution& sol): sol(sol){}
+
+        InnerVar* add(double lb, double ub, double init, VarType type,
+                const string& name);
+
+        Idx size()const { return vars.size(); }
+
+        InnerVar* operator[](const Idx& pos){ return &vars[pos]; }
+
+        const InnerVar* operator[](const Idx& pos)const { return &vars[pos]; }
+
+        //! writes the columns to a snapshot, \sa Model::save()
+        void save(SnapshotWriter& out)const;
+
+        //! replaces the variables by the ones of a snapshot
+        void load(SnapshotReader& in);
+
+        //! exchanges the variables with the ones of other, the handles of
+        //both pools are rebuilt
+        void swap(VarPool& other);
+
+        //! bytes allocated by the handles, columns and names
+        size_t memory()const;
+
+    private:
+        friend class InnerVar;
+
+        std::deque<InnerVar> vars;
+        vector<double> lbs;
+        vector<double> ubs;
+        vector<double> inits;
+        vector<VarType> types;
+        vector<bool> is_fixed;
+        std::unordered_map<Idx, string> names;
         const Solution& sol;
 
-        bool is_fixed;
+        string name(const Idx& pos)const;
 
-        void checkBounds();
+        void checkBounds(const Idx& pos)const;
 };
 }
 #endif
@@ -15,6 +15,7 @@
  */
 #include "ipopt_model.hpp"
 #include "ipopt_nlp.hpp"
+#include "timeline.hpp"
 
 using namespace MadOpt;
 
@@ -38,6 +39,7 @@ IpoptModel::~IpoptModel(){
 }
 
 void IpoptModel::solve(){
+    TIMELINE_SCOPE("solve");
     if (not show_solver){
         setIntegerOption("print_level", 0);
         setStringOption("sb", "yes");
@@ -46,14 +48,29 @@ void IpoptModel::solve(){
     if (timelimit >= 0)
         setNumericOption("max_cpu_time", timelimit);
 
+    auto start = std::chrono::steady_clock::now();
+    finalizeConstraints();
+    clearEvalCache();
+
     if (model_changed)
         impl->Iapp.OptimizeTNLP(impl->ipopt_callback);
     else
         impl->Iapp.ReOptimizeTNLP(impl->ipopt_callback);
 
+    if (collect_stats)
+        model_stats.solve_time += std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
     model_changed = false;
 }
 
+Idx IpoptModel::nofIterations(){
+    auto stats = impl->Iapp.Statistics();
+    if (not Ipopt::IsValid(stats))
+        return 0;
+    return stats->IterationCount();
+}
+
 void IpoptModel::setStringOption(std::string key, std::string value){
     impl->Iapp.Options()->SetStringValue(key, value);
 }
@@ -37,6 +37,9 @@ class IpoptModel: public Model {
 
         void solve();
 
+        //! number of iterations of the last solve() call
+        Idx nofIterations();
+
     private:
         IpoptModelImpl* impl;
 };
@@ -16,6 +16,7 @@
 #include "ipopt_nlp.hpp"
 
 #include "logger.hpp"
+#include "timeline.hpp"
 #include "model.hpp"
 
 using namespace MadOpt;
@@ -94,6 +95,8 @@ bool IpoptUserClass::get_starting_point(Index n, bool init_x, Number* x,
 bool IpoptUserClass::eval_f(Index n, const Number* x, bool new_x, Number& obj_value){
     TRACE_START;
     assert((Idx)n==solver->nx());
+    CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_F), new_x);
+    TIMELINE_SCOPE("eval_f");
     solver->eval_f(x, new_x, obj_value);
     VALGRIND_CONDITIONAL_JUMP_TEST(obj_value);
     TRACE_END;
@@ -104,6 +107,8 @@ bool IpoptUserClass::eval_grad_f(Index n, const Number* x, bool new_x, Number* g
     TRACE_START;
     TRACE("new_x=", new_x);
     assert((Idx)n==solver->nx());
+    CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_GRAD_F), new_x);
+    TIMELINE_SCOPE("eval_grad_f");
     solver->eval_grad_f(x, new_x, grad_f);
     VALGRIND_CONDITIONAL_JUMP_TEST_LOOP(n, grad_f);
     TRACE_END;
@@ -114,6 +119,8 @@ bool IpoptUserClass::eval_g(Index n, const Number* x, bool new_x, Index m, Numbe
     TRACE_START;
     TRACE("new_x=", new_x);
     assert((Idx)n==solver->nx());
+    CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_G), new_x);
+    TIMELINE_SCOPE("eval_g");
     solver->eval_g(x, new_x, g);
     VALGRIND_CONDITIONAL_JUMP_TEST_LOOP(m, g);
     TRACE_END;
@@ -133,6 +140,9 @@ bool IpoptUserClass::eval_jac_g(Index n, const Number* x, bool new_x,
         VALGRIND_CONDITIONAL_JUMP_TEST_LOOP(nele_jac, jCol);
         VALGRIND_CONDITIONAL_JUMP_TEST_LOOP(nele_jac, iRow);
     } else {
+        CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_JAC_G),
+                new_x);
+        TIMELINE_SCOPE("eval_jac_g");
         solver->eval_jac_g(x, new_x, values);
         VALGRIND_CONDITIONAL_JUMP_TEST_LOOP(nele_jac, values);
     }
@@ -155,6 +165,9 @@ bool IpoptUserClass::eval_h(Index n, const Number* x, bool new_x,
         VALGRIND_CONDITIONAL_JUMP_TEST_LOOP(nele_hess, jCol);
         VALGRIND_CONDITIONAL_JUMP_TEST_LOOP(nele_hess, iRow);
     } else {
+        CallbackTimer timer(solver->callbackStats(ModelStats::EVAL_H),
+                new_x);
+        TIMELINE_SCOPE("eval_h");
         solver->eval_h(x, new_x, values, obj_factor, lambda);
         VALGRIND_CONDITIONAL_JUMP_TEST_LOOP(nele_hess, values);
     }
@@ -40,6 +40,11 @@ class JacSimStack : public ListSimStack<Idx> {
             last_pos_map.resize(size, 0);
         }
 
+        //! bytes allocated by the stack
+        size_t memory()const {
+            return ListSimStack<Idx>::memory() + MadOpt::memory(last_pos_map);
+        }
+
     private:
         vector<Idx> last_pos_map;
 
@@ -23,17 +23,41 @@
 
 namespace MadOpt {
 
+//! read cursor over the conflicts of a constraint computed by the SimStack
+class ConflictCursor{
+    public:
+        ConflictCursor(): pos(nullptr){}
+
+        void reset(const Idx* conflicts){
+            pos = conflicts;
+        }
+
+        const Idx& next(){
+            return *(pos++);
+        }
+
+        const Idx& current()const {
+            return *pos;
+        }
+
+        void skip(const Idx& nof){
+            pos += nof;
+        }
+
+    private:
+        const Idx* pos;
+};
+
 class ListCStack{
     public:
         ListCStack(): stack(1) {}
 
         void merge(const Idx& nofelems){
             TRACE_START;
-            TRACE("conf elems", conflicts->str());
-            Idx& counter = conflicts->next();
+            const Idx& counter = conflicts->next();
             for (Idx i=0; i<counter; i++){
-                Idx& to = conflicts->next();
-                Idx& from = conflicts->next();
+                const Idx& to = conflicts->next();
+                const Idx& from = conflicts->next();
                 ASSERT_BETWEEN(1, to, stack.size()-2, to, from);
                 ASSERT_BETWEEN(1, from, stack.size()-1);
                 ASSERT_LE(to, from);
@@ -48,6 +72,12 @@ class ListCStack{
             TRACE_END;
         }
 
+        //! consume the conflicts of a merge without touching the stack
+        void skipMerge(){
+            const Idx& counter = conflicts->next();
+            conflicts->skip(2*counter);
+        }
+
         void mulAllLast(const double& value){
             for (Idx i=positions.back(1); i<stack.size(); i++)
                 stack[i] *= value;
@@ -58,13 +88,30 @@ class ListCStack{
                 stack[i] *= value;
         }
 
+        //! first position of element i of the last nofelems elements
+        const Idx& elemBegin(const Idx& nofelems, const Idx& i)const {
+            return positions.back(nofelems-i);
+        }
+
+        //! position behind element i of the last nofelems elements
+        const Idx& elemEnd(const Idx& nofelems, const Idx& i)const {
+            return i+1 < nofelems ? positions.back(nofelems-i-1)
+                : stack.size();
+        }
+
+        void mulElem(const Idx& nofelems, const Idx& i, const double& value){
+            const Idx& end = elemEnd(nofelems, i);
+            for (Idx k=elemBegin(nofelems, i); k<end; k++)
+                stack[k] *= value;
+        }
+
         void emplace_back_empty(){
             positions.pushSave(stack.size());
         }
 
         void clear(){
             stack.clear();
-            stack.getEndAndPush();
+            stack.getEndAndPushSave();
             positions.clear();
         }
 
@@ -79,7 +126,16 @@ class ListCStack{
             TRACE_END;
         }
 
-        void setConflicts(Array<Idx>* c){
+        //! like fill(double*) but writes element i to data[map[i]]
+        void fill(double* data, const Idx* map){
+            TRACE_START;
+            ASSERT_EQ(positions.back(), 1);
+            for (Idx i=1; i<stack.size(); i++)
+                data[map[i-1]] = stack[i];
+            TRACE_END;
+        }
+
+        void setConflicts(ConflictCursor* c){
             //ASSERT(c != nullptr);
             conflicts = c;
         }
@@ -134,10 +190,15 @@ class ListCStack{
             return res;
         }
 
+        //! bytes allocated by the stack
+        size_t memory()const {
+            return stack.memory() + positions.memory();
+        }
+
     private:
         Array<double> stack;
         Array<Idx> positions;
-        Array<Idx>* conflicts;
+        ConflictCursor* conflicts;
 };
 }
 #endif
@@ -117,6 +117,13 @@ class ListSimStack{
             return _max_size;
         }
 
+        //! raise max_size() to at least s, for stacks that share the result
+        //buffers
+        void raiseMaxSize(const Idx& s){
+            if (s > _max_size)
+                _max_size = s;
+        }
+
         virtual string str(){
             if (positions.size() == 0)
                 return "-";
@@ -133,6 +140,11 @@ class ListSimStack{
             return res;
         }
 
+        //! bytes allocated by the stack
+        size_t memory()const {
+            return stack.memory() + positions.memory();
+        }
+
     protected:
         Array<ListSimStackElem> stack;
         Array<Idx> positions;
@@ -19,10 +19,14 @@
 #include <string.h>
 #include <iostream>
 #include <type_traits>
+#ifdef ENABLE_TIMELINE_TRACING
+#include "timeline.hpp"
+#endif
 
 namespace MadOpt {
  
 //#define ENABLE_TRACING
+//#define ENABLE_TIMELINE_TRACING
 //#define ENABLE_VALGRIND_DEBUGGING
 //#define ENABLE_ASSERTS
 
@@ -71,7 +75,12 @@ struct tracer {
 #endif
 
 #define TRACE_END TRACE("End")
+#ifdef ENABLE_TIMELINE_TRACING
+// every traced function becomes a span of the timeline
+#define TRACE_START TRACE("Start"); TIMELINE_SCOPE(__func__)
+#else
 #define TRACE_START TRACE("Start")
+#endif
 
 // debug stuff
 //
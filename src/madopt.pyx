@@ -15,6 +15,8 @@
 #
 import signal
 from libcpp.string cimport string
+from libcpp.vector cimport vector
+from libcpp.map cimport map
 from libcpp cimport bool
 
 
@@ -48,6 +50,10 @@ cdef extern from "model.hpp":
 
     cdef Expr_ elog2 "MadOpt::log2" (Expr_&)
 
+    cdef Expr_ eexp "MadOpt::exp" (Expr_&)
+
+    cdef Expr_ esqrt "MadOpt::sqrt" (Expr_&)
+
     cdef Expr_ epow "MadOpt::pow" (Expr_&, double)
 
     cdef cppclass Var_ "MadOpt::Var"(Expr_):
@@ -77,10 +83,117 @@ cdef extern from "model.hpp":
         void lb(double)
         void ub(double)
 
+    cdef cppclass EvalCache_ "MadOpt::EvalCache":
+        size_t nofHits()
+        size_t nofMisses()
+        size_t size()
+        size_t memory()
+        size_t getBudget()
+
+    cdef cppclass ConstraintProfile_ "MadOpt::ConstraintProfile":
+        Constraint_ constraint
+        unsigned int row
+        bool objective
+        double time
+        unsigned int samples
+        unsigned int tape_size
+        unsigned int nnz_jac
+        unsigned int nnz_hess
+        unsigned int nof_conflicts
+        string expr
+
+    cdef cppclass MemoryReport_ "MadOpt::MemoryReport":
+        size_t vars
+        size_t params
+        size_t constraints
+        size_t tapes
+        size_t jac_hess
+        size_t stacks
+        size_t hash_maps
+        size_t eval_cache
+        size_t solution
+        size_t file_backed
+        size_t process_rss
+        size_t total()
+
+    cdef cppclass Distribution_ "MadOpt::Distribution":
+        unsigned int min
+        unsigned int max
+        double mean
+        vector[unsigned int] histogram
+
+    cdef cppclass ModelAnalysis_ "MadOpt::ModelAnalysis":
+        unsigned int nx
+        unsigned int ng
+        map[string, unsigned int] opcodes
+        Distribution_ tape_length
+        Distribution_ tape_depth
+        Distribution_ jac_row
+        Distribution_ jac_col
+        Distribution_ conflicts
+        unsigned int nnz_jac
+        unsigned int nnz_hess
+        double hess_density
+        unsigned int linear
+        unsigned int quadratic
+        unsigned int nonlinear
+        unsigned int custom
+        int objective_degree
+        unsigned int shapes
+        unsigned int identical
+
+    cdef cppclass CallbackStats_ "MadOpt::CallbackStats":
+        unsigned int calls
+        unsigned int new_x
+        double total_time
+        double max_time
+        double hitRate()
+
+    cdef cppclass PerfCounts_ "MadOpt::PerfCounts":
+        unsigned long long cycles
+        unsigned long long instructions
+        unsigned long long cache_misses
+        unsigned long long branch_misses
+        double ipc()
+
+    cdef cppclass PhaseStats_ "MadOpt::PhaseStats":
+        unsigned int calls
+        double total_time
+        PerfCounts_ counters
+
+    cdef cppclass ModelStats_ "MadOpt::ModelStats":
+        CallbackStats_ callbacks[5]
+        PhaseStats_ phases[3]
+        double solve_time
+        bool hardware_counters
+        double callbackTime()
+
     cdef cppclass Model_ "MadOpt::Model":
         void solAsInit()
         bool show_solver
         double timelimit
+        bool keep_names
+        bool hess_skipping
+        double hess_skip_threshold
+        unsigned int symbolic_threads
+        unsigned int eval_threads
+        unsigned int split_terms
+        size_t nofSkippedHessRows()
+        size_t nofEvaluatedHessRows()
+        void resetHessCounters()
+        bool collect_stats
+        ModelStats_ stats()
+        void resetStats()
+        void profileConstraints(unsigned int)
+        vector[ConstraintProfile_] constraintProfile(unsigned int, size_t)
+        void resetConstraintProfile()
+        MemoryReport_ memoryReport()
+        ModelAnalysis_ analyze() except +
+        void setEvalCacheBudget(size_t)
+        EvalCache_& getEvalCache()
+        void clearEvalCache()
+        void setIncrementalEvals(bool)
+        bool incrementalEvals()
         void solve()
         int status()
         double objValue()
@@ -96,6 +209,14 @@ cdef extern from "model.hpp":
         int ng()
         int np()
         Constraint_ addConstr(double, Expr_&, double)
+        vector[Constraint_] addConstrs(vector[double]&, vector[Expr_]&, vector[double]&) except +
+        void finalizeConstraints()
+        void save(string) except +
+        void load(string) except +
+        Var_ getVar(unsigned int) except +
+        Param_ getParam(unsigned int) except +
+        void mapConstraintData(string) except +
+        void readNL(string) except +
         bool hasSolution()
 
 ctypedef double (*g_type)(void *param, void *g_data)
@@ -104,11 +225,20 @@ cdef extern from "python_callback.hpp":
     cdef cppclass PythonCallback:
         PythonCallback(g_type gtype, void *g_data)
 
+cdef extern from "timeline.hpp":
+    void timelineStart "MadOpt::Timeline::start"(size_t) except +
+    void timelineStop "MadOpt::Timeline::stop"()
+    void timelineWrite "MadOpt::Timeline::write"(string) except +
+
 cdef double callback_template(void *parameter, void *method):
     return (<object>method)(<object>parameter)
 
 INFINITY = INF
 
+cdef distribution_dict(Distribution_ d):
+    return {'min': d.min, 'max': d.max, 'mean': d.mean,
+            'histogram': d.histogram}
+
 def convert(e):
     if isinstance(e, (float, int)):
         return Expr(e)
@@ -212,6 +342,26 @@ def log2(Expr ip):
     e.expr_ = elog2(ip.expr_)
     return e
 
+def exp(Expr ip):
+    e = Expr()
+    e.expr_ = eexp(ip.expr_)
+    return e
+
+def sqrt(Expr ip):
+    e = Expr()
+    e.expr_ = esqrt(ip.expr_)
+    return e
+
+# timeline of the model build and the solver callbacks
+def startTimeline(size_t spans_per_thread=1<<16):
+    timelineStart(spans_per_thread)
+
+def stopTimeline():
+    timelineStop()
+
+def writeTimeline(path):
+    timelineWrite(path.encode('UTF-8'))
+
 cdef class Var(Expr):
     cdef Var_ getVar(self):
         return (<Var_>self.expr_)
@@ -311,21 +461,21 @@ cdef class Model:
 
     def addCVar(self, double lb=-INF, double ub=INF, init=None, name=None):
         init = init or max(lb, min(ub, 0.0))
-        name = name or ('v' + str(self.model_.nx()))
+        name = name or ''
         e = Var()
         e.expr_ = self.model_.addCVar(lb, ub, init, name.encode('UTF-8'))
         return e
 
     def addIVar(self, lb=-INF, ub=INF, init=None, name=None):
         init = int(init or max(lb, min(ub, 0.0)))
-        name = name or ('v' + str(self.model_.nx()))
+        name = name or ''
         e = Var()
         e.expr_ = self.model_.addIVar(lb, ub, init, name.encode('UTF-8'))
         return e
 
     def addBVar(self, init=None, name=None):
         init = init or 1.0
-        name = name or ('v' + str(self.model_.nx()))
+        name = name or ''
         e = Var()
         e.expr_ = self.model_.addBVar(init, name.encode('UTF-8'))
         return e
@@ -334,7 +484,7 @@ cdef class Model:
     #
     #
     def addParam(self, double v, name=None):
-        name = name or ('p' + str(self.model_.np()))
+        name = name or ''
         e = Param()
         e.expr_ = self.model_.addParam(v, name.encode('UTF-8'))
         return e
@@ -356,6 +506,49 @@ cdef class Model:
     def addEqConstr(self, Expr expr, double eq=0):
         return self.addConstr(expr, lb=eq, ub=eq)
 
+    def addConstrs(self, exprs, lbs=None, ubs=None):
+        cdef vector[Expr_] c_exprs
+        cdef vector[double] c_lbs
+        cdef vector[double] c_ubs
+        for i, expr in enumerate(exprs):
+            c_exprs.push_back((<Expr?>expr).expr_)
+            c_lbs.push_back(-INFINITY if lbs is None else lbs[i])
+            c_ubs.push_back(INFINITY if ubs is None else ubs[i])
+        res = []
+        for con in self.model_.addConstrs(c_lbs, c_exprs, c_ubs):
+            c = Constraint()
+            c.constraint_ = con
+            res.append(c)
+        return res
+
+    def finalizeConstraints(self):
+        self.model_.finalizeConstraints()
+
+    def readNL(self, path):
+        self.model_.readNL(path.encode('UTF-8'))
+
+    # snapshots
+    #
+    #
+    def save(self, path):
+        self.model_.save(path.encode('UTF-8'))
+
+    def load(self, path):
+        self.model_.load(path.encode('UTF-8'))
+
+    def getVar(self, unsigned int pos):
+        e = Var()
+        e.expr_ = self.model_.getVar(pos)
+        return e
+
+    def getParam(self, unsigned int idx):
+        e = Param()
+        e.expr_ = self.model_.getParam(idx)
+        return e
+
+    def mapConstraintData(self, path):
+        self.model_.mapConstraintData(path.encode('UTF-8'))
+
     # get Solution
     #
     #
@@ -411,6 +604,178 @@ cdef class Model:
         def __get__(self):
             return self.model_.hasSolution()
 
+    property hess_skipping:
+        def __get__(self):
+            return self.model_.hess_skipping
+
+        def __set__(self, bool value):
+            self.model_.hess_skipping = value
+
+    property hess_skip_threshold:
+        def __get__(self):
+            return self.model_.hess_skip_threshold
+
+        def __set__(self, double value):
+            self.model_.hess_skip_threshold = value
+
+    property keep_names:
+        def __get__(self):
+            return self.model_.keep_names
+
+        def __set__(self, bool value):
+            self.model_.keep_names = value
+
+    property symbolic_threads:
+        def __get__(self):
+            return self.model_.symbolic_threads
+
+        def __set__(self, unsigned int value):
+            self.model_.symbolic_threads = value
+
+    property eval_threads:
+        def __get__(self):
+            return self.model_.eval_threads
+
+        def __set__(self, unsigned int value):
+            self.model_.eval_threads = value
+
+    property split_terms:
+        def __get__(self):
+            return self.model_.split_terms
+
+        def __set__(self, unsigned int value):
+            self.model_.split_terms = value
+
+    @property
+    def hess_skipped_rows(self):
+        return self.model_.nofSkippedHessRows()
+
+    @property
+    def hess_evaluated_rows(self):
+        return self.model_.nofEvaluatedHessRows()
+
+    def resetHessCounters(self):
+        self.model_.resetHessCounters()
+
+    property collect_stats:
+        def __get__(self):
+            return self.model_.collect_stats
+
+        def __set__(self, bool value):
+            self.model_.collect_stats = value
+
+    def stats(self):
+        cdef ModelStats_ stats = self.model_.stats()
+        res = {'solve_time': stats.solve_time,
+               'callback_time': stats.callbackTime()}
+        names = ['eval_f', 'eval_grad_f', 'eval_g', 'eval_jac_g', 'eval_h']
+        for i, name in enumerate(names):
+            res[name] = {'calls': stats.callbacks[i].calls,
+                         'new_x': stats.callbacks[i].new_x,
+                         'total_time': stats.callbacks[i].total_time,
+                         'max_time': stats.callbacks[i].max_time,
+                         'hit_rate': stats.callbacks[i].hitRate()}
+        res['hardware_counters'] = stats.hardware_counters
+        for i, name in enumerate(['forward', 'jacobian', 'hessian']):
+            res[name] = {'calls': stats.phases[i].calls,
+                         'total_time': stats.phases[i].total_time,
+                         'cycles': stats.phases[i].counters.cycles,
+                         'instructions': stats.phases[i].counters.instructions,
+                         'cache_misses': stats.phases[i].counters.cache_misses,
+                         'branch_misses': stats.phases[i].counters.branch_misses,
+                         'ipc': stats.phases[i].counters.ipc()}
+        return res
+
+    def resetStats(self):
+        self.model_.resetStats()
+
+    def profileConstraints(self, unsigned int every=1):
+        self.model_.profileConstraints(every)
+
+    def constraintProfile(self, unsigned int top=10, size_t max_expr_length=80):
+        res = []
+        for p in self.model_.constraintProfile(top, max_expr_length):
+            c = None
+            if not p.objective:
+                c = Constraint()
+                c.constraint_ = p.constraint
+            res.append({'constraint': c,
+                        'row': p.row,
+                        'objective': p.objective,
+                        'time': p.time,
+                        'samples': p.samples,
+                        'tape_size': p.tape_size,
+                        'nnz_jac': p.nnz_jac,
+                        'nnz_hess': p.nnz_hess,
+                        'conflicts': p.nof_conflicts,
+                        'expr': p.expr.decode('UTF-8')})
+        return res
+
+    def resetConstraintProfile(self):
+        self.model_.resetConstraintProfile()
+
+    def memoryReport(self):
+        cdef MemoryReport_ r = self.model_.memoryReport()
+        return {'vars': r.vars,
+                'params': r.params,
+                'constraints': r.constraints,
+                'tapes': r.tapes,
+                'jac_hess': r.jac_hess,
+                'stacks': r.stacks,
+                'hash_maps': r.hash_maps,
+                'eval_cache': r.eval_cache,
+                'solution': r.solution,
+                'file_backed': r.file_backed,
+                'process_rss': r.process_rss,
+                'total': r.total()}
+
+    def analyze(self):
+        cdef ModelAnalysis_ a = self.model_.analyze()
+        opcodes = a.opcodes
+        return {'nx': a.nx,
+                'ng': a.ng,
+                'opcodes': {k.decode('UTF-8'): v for k, v in opcodes.items()},
+                'tape_length': distribution_dict(a.tape_length),
+                'tape_depth': distribution_dict(a.tape_depth),
+                'jac_row': distribution_dict(a.jac_row),
+                'jac_col': distribution_dict(a.jac_col),
+                'conflicts': distribution_dict(a.conflicts),
+                'nnz_jac': a.nnz_jac,
+                'nnz_hess': a.nnz_hess,
+                'hess_density': a.hess_density,
+                'linear': a.linear,
+                'quadratic': a.quadratic,
+                'nonlinear': a.nonlinear,
+                'custom': a.custom,
+                'objective_degree': a.objective_degree,
+                'shapes': a.shapes,
+                'identical': a.identical}
+
+    property eval_cache_budget:
+        def __get__(self):
+            return self.model_.getEvalCache().getBudget()
+
+        def __set__(self, size_t value):
+            self.model_.setEvalCacheBudget(value)
+
+    @property
+    def eval_cache_hits(self):
+        return self.model_.getEvalCache().nofHits()
+
+    @property
+    def eval_cache_misses(self):
+        return self.model_.getEvalCache().nofMisses()
+
+    def clearEvalCache(self):
+        self.model_.clearEvalCache()
+
+    property incremental_evals:
+        def __get__(self):
+            return self.model_.incrementalEvals()
+
+        def __set__(self, bool value):
+            self.model_.setIncrementalEvals(value)
+
     # set Option
     #
     #
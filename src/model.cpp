@@ -23,20 +23,22 @@
 #include "inner_constraint.hpp"
 #include "constraint.hpp"
 #include "logger.hpp"
+#include "snapshot.hpp"
+#include "nl_reader.hpp"
+#include "timeline.hpp"
+#include "operator.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <fstream>
+#include <unistd.h>
+#include <unordered_set>
 
 using namespace MadOpt;
 
 Model::~Model(){
-    FOREACH(p, vars)
-    //for (auto& p: vars){
-        delete p;
-    }
-
-    FOREACH(p, params)
-    //for (auto& p: params){
-        delete p;
-    }
-
     FOREACH(p, constraints)
     //for (auto& p: constraints){
         delete p;
@@ -95,30 +97,235 @@ Var Model::addBVar(string name){
 //Constraint stuff
 //
 //
-Constraint Model::addConstr(const double lb, const Expr& expr, const double ub){
-    TRACE_START;
+void Model::checkConstr(const double lb, const Expr& expr, const double ub){
     if (lb > ub)
         throw MadOptError("lower bound is greater then upper bound for expr=" 
                 + expr.toString() 
                 + " lb=" + std::to_string((long double)lb) 
                 + " ub=" + std::to_string((long double)ub));
-    auto vars = expr.getInnerVariables();
-    FOREACH(var, vars)
-    //for (auto& var: vars){
-        const Solution& sol = var->getSolution();
-        if (&solution != &sol)
+    // the solution reference of a variable identifies its model
+    FOREACH(op, expr)
+        if (op.getType() == OP_VAR_POINTER
+                && &(op.getIVar()->getSolution()) != &solution)
             throw MadOptError("cannot add variable from other model to this model");
+        else if (op.getType() == OP_PARAM_POINTER
+                && &(op.getIParam()->getPool()) != &params)
+            throw MadOptError("cannot add parameter from other model to this model");
     }
+}
+
+Constraint Model::addConstr(const double lb, const Expr& expr, const double ub){
+    TRACE_START;
+    TIMELINE_SCOPE("addConstr");
+    checkConstr(lb, expr, ub);
     TRACE(expr.toString());
+    finalizeConstraints();
     simstack.setXSize(nx());
-    auto con = new InnerConstraint(expr, lb, ub, hess_pos_map, simstack);
-    cstack.resize(simstack);
+    auto con = new InnerConstraint(expr, lb, ub, &arena);
+    analyzeConstr(con, simstack);
+    con->mapHess(hess_pos_map);
+    resizeStacks();
     return addConstr(con);
 }
 
+vector<Constraint> Model::addConstrs(const vector<double>& lbs,
+        const vector<Expr>& exprs, const vector<double>& ubs){
+    if (lbs.size() != exprs.size() || ubs.size() != exprs.size())
+        throw MadOptError("addConstrs needs one lower and upper bound per expression");
+    return addConstrs(exprs.size(), [&](const Idx& i, double& lb, double& ub){
+            lb = lbs[i];
+            ub = ubs[i];
+            return exprs[i];
+        });
+}
+
+vector<Constraint> Model::addConstrs(const Idx& n,
+        const std::function<Expr(const Idx&, double&, double&)>& builder){
+    TRACE_START;
+    TIMELINE_SCOPE("addConstrs");
+    vector<Constraint> result;
+    result.reserve(n);
+    constraints.reserve(constraints.size() + n);
+    pending.reserve(pending.size() + n);
+    for (Idx i=0; i<n; i++){
+        double lb = -INF;
+        double ub = INF;
+        Expr expr = builder(i, lb, ub);
+        checkConstr(lb, expr, ub);
+        auto con = new InnerConstraint(expr, lb, ub, &arena);
+        constraints.push_back(con);
+        pending.push_back(con);
+        result.emplace_back(this, constraints.size()-1);
+    }
+    clearEvalCache();
+    con_order = -1;
+    model_changed = true;
+    TRACE_END;
+    return result;
+}
+
+void Model::finalizeConstraints(){
+    if (pending.empty())
+        return;
+    TRACE_START;
+    TIMELINE_SCOPE("finalizeConstraints");
+    // threads only pay off for larger batches
+    const Idx min_chunk = 256;
+    Idx nof_threads = symbolic_threads;
+    if (nof_threads == 0)
+        nof_threads = std::thread::hardware_concurrency();
+    nof_threads = std::min<Idx>(nof_threads, pending.size()/min_chunk);
+
+    simstack.setXSize(nx());
+    if (nof_threads > 1)
+        analyzePending(nof_threads);
+    else {
+        TIMELINE_SCOPE("analyze");
+        FOREACH(con, pending)
+            analyzeConstr(con, simstack);
+        }
+    }
+
+    // sequential to keep the hessian positions independent of the number of
+    // threads
+    {
+        TIMELINE_SCOPE("mapHess");
+        jac_offsets.reserve(constraints.size() + 1);
+        FOREACH(con, pending)
+            con->mapHess(hess_pos_map);
+            jac_offsets.push_back(jac_offsets.back() + con->getNNZ_Jac());
+            cache_rows += con->evalsSize();
+        }
+    }
+    resizeStacks();
+    pending.clear();
+    TRACE_END;
+}
+
+void Model::analyzePending(Idx nof_threads){
+    TRACE_START;
+    vector<SimStack> stacks(nof_threads);
+    vector<std::exception_ptr> errors(nof_threads);
+    vector<std::thread> threads;
+    Idx chunk = (pending.size() + nof_threads - 1) / nof_threads;
+    for (Idx t=0; t<nof_threads; t++){
+        threads.emplace_back([&, t](){
+            try {
+                TIMELINE_SCOPE("analyze");
+                SimStack& stack = stacks[t];
+                stack.setXSize(nx());
+                Idx end = std::min<Idx>((t+1)*chunk, pending.size());
+                for (Idx i=t*chunk; i<end; i++)
+                    analyzeConstr(pending[i], stack);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    FOREACH(thread, threads)
+        thread.join();
+    }
+    FOREACH(error, errors)
+        if (error)
+            std::rethrow_exception(error);
+    }
+    FOREACH(stack, stacks)
+        simstack.raiseMaxSizes(stack);
+    }
+    TRACE_END;
+}
+
+Idx Model::evalThreads()const{
+    if (eval_threads == 0)
+        return std::max<Idx>(std::thread::hardware_concurrency(), 1);
+    return eval_threads;
+}
+
+void Model::analyzeConstr(InnerConstraint* con, SimStack& stack){
+    con->analyze(stack, evalThreads(), split_terms);
+}
+
+void Model::resizeStacks(){
+    cstack.resize(simstack);
+    FOREACH(stack, eval_stacks)
+        stack.resize(simstack);
+    }
+}
+
+void Model::updateEvalPool(){
+    const Idx nof_threads = evalThreads();
+    if (nof_threads < 2){
+        if (eval_pool != nullptr)
+            eval_pool_starts++;
+        eval_pool.reset();
+        eval_stacks.clear();
+        cstack.setWorkers(nullptr, nullptr);
+        return;
+    }
+    if (eval_pool != nullptr && eval_pool->size() == nof_threads)
+        return;
+    eval_pool.reset(new ThreadPool(nof_threads));
+    eval_pool_starts++;
+    eval_stacks.resize(nof_threads - 1);
+    resizeStacks();
+    cstack.setWorkers(eval_pool.get(), eval_stacks.data());
+}
+
+void Model::checkTape(const InnerConstraint::Tape& tape)const {
+    // number of operands on the stack while the tape is evaluated
+    Idx depth = 0;
+    Idx data_i = 0;
+    FOREACH(type, tape.ops)
+        Idx nof_children = type == OP_DIV ? 2 : 1;
+        if (InnerConstraint::hasData(type)){
+            if (data_i == tape.data.size())
+                throw MadOptError("malformed tape");
+            const Value& value = tape.data[data_i++];
+            if (type == OP_VAR_IDX && value.idx >= nx())
+                throw MadOptError("tape refers to unknown variable "
+                        + to_string(value.idx));
+            if (type == OP_VAR_POINTER || type == OP_PARAM_SLOT)
+                throw MadOptError("tapes cannot contain variable pointers or slots");
+            if (type == OP_PARAM_POINTER && &value.iParam->getPool() != &params)
+                throw MadOptError("cannot add parameter from other model to this model");
+            if (type == OP_ADD || type == OP_MUL)
+                nof_children = value.idx;
+            else if (type != OP_POW && type != OP_IPOW)
+                nof_children = 0;
+        }
+        if (nof_children > depth || ((type == OP_ADD || type == OP_MUL)
+                    && nof_children == 0))
+            throw MadOptError("malformed tape");
+        depth = depth - nof_children + 1;
+    }
+    if (depth != 1 || data_i != tape.data.size())
+        throw MadOptError("malformed tape");
+}
+
+Constraint Model::addConstr(const double lb, InnerConstraint::Tape tape,
+        const double ub){
+    TRACE_START;
+    checkTape(tape);
+    auto con = new InnerConstraint(std::move(tape), lb, ub, &arena);
+    constraints.push_back(con);
+    pending.push_back(con);
+    clearEvalCache();
+    con_order = -1;
+    model_changed = true;
+    TRACE_END;
+    return Constraint(this, constraints.size()-1);
+}
+
 Constraint Model::addConstr(ConstraintInterface* con) {
   TRACE_START;
+  finalizeConstraints();
   constraints.push_back(con);
+  jac_offsets.push_back(jac_offsets.back() + con->getNNZ_Jac());
+  cache_rows += con->evalsSize();
+  if (con->evalsSize() == 0)
+      uncachable_rows++;
+  clearEvalCache();
+  con_order = -1;
   model_changed = true;
   TRACE_END;
   return Constraint(this, constraints.size()-1);
@@ -140,36 +347,61 @@ Constraint Model::addConstr(const double lb, const Expr& expr){
 //
 //
 void Model::setObj(const Expr& expr){
+    simstack.setXSize(nx());
+    auto con = new InnerConstraint(expr, 0, 0);
+    analyzeConstr(con, simstack);
+    con->mapHess(hess_pos_map);
+    resizeStacks();
+    setObj(con);
+}
+
+void Model::setObj(InnerConstraint::Tape tape){
+    checkTape(tape);
+    simstack.setXSize(nx());
+    auto con = new InnerConstraint(std::move(tape), 0, 0);
+    analyzeConstr(con, simstack);
+    con->mapHess(hess_pos_map);
+    resizeStacks();
+    setObj(con);
+}
+
+void Model::setObj(ConstraintInterface* constraint){
     model_changed = true;
-    if (obj != 0)
+    if (obj != 0){
+        cache_rows -= obj->evalsSize();
         delete obj;
-    simstack.setXSize(nx());
-    obj = new InnerConstraint(expr, 0, 0, hess_pos_map, simstack);
-    cstack.resize(simstack);
+    }
+    obj = constraint;
+    cache_rows += obj->evalsSize();
+    clearEvalCache();
+    obj_order = -1;
     obj_jac_map.clear();
     obj_jac_map.resize(obj->getNNZ_Jac());
     obj->getNZ_Jac(obj_jac_map.data());
 }
 
+void Model::readNL(const string& path){
+    TIMELINE_SCOPE("readNL");
+    NLReader(*this).read(path);
+}
+
 //NLP init stuff
 //
 //
 Idx Model::getNNZ_Jac(){
-    int res = 0;
-    FOREACH(constr, constraints)
-    //for (auto& constr: constraints){
-        res += constr->getNNZ_Jac();
-    }
-    VALGRIND_CONDITIONAL_JUMP_TEST(res);
-    return res;
+    finalizeConstraints();
+    VALGRIND_CONDITIONAL_JUMP_TEST(jac_offsets.back());
+    return jac_offsets.back();
 }
 
 Idx Model::getNNZ_Hess(){
+    finalizeConstraints();
     return hess_pos_map.size();
 }
 
 void Model::getNZ_Jac(int* iRow, int* jCol){
     TRACE_START;
+    finalizeConstraints();
     int nz = 0;
     int pos = 0;
     FOREACH(constr, constraints)
@@ -188,6 +420,7 @@ void Model::getNZ_Jac(int* iRow, int* jCol){
 }
 
 void Model::getNZ_Hess(int* iRow, int* jCol){
+    finalizeConstraints();
     FOREACH(it, hess_pos_map)
     //for (auto& it: hess_pos_map){
         iRow[it.second] = it.first.first;
@@ -219,10 +452,138 @@ void Model::getInits(double* xi){
 }
 
 void Model::solAsInit(){
-    FOREACH(var, vars)
-    //for (auto& var: vars){
-        var->solAsInit();
+    for (Idx i=0; i<nx(); i++)
+        vars[i]->solAsInit();
+}
+
+void Model::save(const string& path){
+    TRACE_START;
+    TIMELINE_SCOPE("save");
+    finalizeConstraints();
+    auto inner = [](ConstraintInterface* con){
+        auto result = dynamic_cast<InnerConstraint*>(con);
+        if (result == nullptr)
+            throw MadOptError("only constraints based on Expr can be saved");
+        return result;
+    };
+    InnerConstraint* objective = inner(obj);
+    vector<InnerConstraint::Layout> layouts;
+    layouts.reserve(constraints.size());
+    FOREACH(con, constraints)
+        layouts.push_back(inner(con)->layout());
+    }
+    vector<Idx> hess_rows(hess_pos_map.size());
+    vector<Idx> hess_cols(hess_pos_map.size());
+    FOREACH(it, hess_pos_map)
+        hess_rows[it.second] = it.first.first;
+        hess_cols[it.second] = it.first.second;
     }
+
+    SnapshotWriter out(path);
+    vars.save(out);
+    params.save(out);
+    arena.save(out);
+    out.array(layouts);
+    out.value(objective->layout());
+    objective->getArena().save(out);
+    out.array(hess_rows);
+    out.array(hess_cols);
+    out.value(simstack.max_g_size());
+    out.value(simstack.max_jac_size());
+    out.value(simstack.max_hess_size());
+    out.close();
+    TRACE_END;
+}
+
+void Model::load(const string& path){
+    TRACE_START;
+    TIMELINE_SCOPE("load");
+    if (nx() > 0 || np() > 0 || ng() > 0 || not pending.empty())
+        throw MadOptError("a snapshot can only be loaded into an empty model");
+    // everything is read and checked before the model changes, a corrupt
+    // snapshot leaves it empty
+    SnapshotReader in(path);
+    VarPool new_vars(solution);
+    ParamPool new_params;
+    ConstraintArena new_arena;
+    new_vars.load(in);
+    new_params.load(in);
+    new_arena.load(in, new_params);
+    size_t n;
+    auto layouts = in.array<InnerConstraint::Layout>(n);
+    std::unique_ptr<InnerConstraint> objective(
+            new InnerConstraint(in.value<InnerConstraint::Layout>()));
+    objective->getArena().load(in, new_params);
+    vector<Idx> hess_rows;
+    vector<Idx> hess_cols;
+    in.array(hess_rows);
+    in.array(hess_cols);
+    Idx max_g = in.value<Idx>();
+    Idx max_jac = in.value<Idx>();
+    Idx max_hess = in.value<Idx>();
+
+    const Idx new_nx = new_vars.size();
+    bool valid = hess_rows.size() == hess_cols.size();
+    HessPosMap new_hess_pos_map;
+    new_hess_pos_map.reserve(hess_rows.size());
+    for (Idx i=0; i<hess_rows.size() && valid; i++)
+        valid = hess_rows[i] < new_nx && hess_cols[i] < new_nx
+            && new_hess_pos_map.insert({PII(hess_rows[i], hess_cols[i]), i}).second;
+    // the stored stack sizes have to suffice, the stacks are sized to
+    // what the sweeps need
+    SimStack needed;
+    auto check = [&](InnerConstraint& con){
+        return con.check(new_nx, new_hess_pos_map.size(), max_g, max_jac,
+                max_hess, needed);
+    };
+    valid = valid
+        && InnerConstraint::fits(objective->layout(), objective->getArena())
+        && check(*objective);
+    for (Idx i=0; i<n && valid; i++){
+        valid = InnerConstraint::fits(layouts[i], new_arena);
+        if (valid){
+            InnerConstraint con(layouts[i], &new_arena);
+            valid = check(con);
+        }
+    }
+    if (not valid)
+        throw MadOptError("snapshot " + path + " is corrupt");
+
+    vars.swap(new_vars);
+    params.swap(new_params);
+    arena.swap(new_arena);
+    // the params moved into this model with their pool
+    arena.param_pool = &params;
+    objective->getArena().param_pool = &params;
+    hess_pos_map.swap(new_hess_pos_map);
+
+    constraints.reserve(n);
+    jac_offsets.reserve(n + 1);
+    for (Idx i=0; i<n; i++)
+        addConstr(new InnerConstraint(layouts[i], &arena));
+
+    setObj(objective.release());
+
+    simstack.setXSize(nx());
+    simstack.raiseMaxSizes(needed);
+    resizeStacks();
+    TRACE_END;
+}
+
+void Model::mapConstraintData(const string& dir){
+    arena.mapToFiles(dir);
+}
+
+Var Model::getVar(const Idx& pos){
+    if (pos >= nx())
+        throw MadOptError("there is no variable at position " + to_string(pos));
+    return Var(vars[pos]);
+}
+
+Param Model::getParam(const Idx& idx){
+    if (idx >= np())
+        throw MadOptError("there is no parameter with index " + to_string(idx));
+    return Param(params[idx]);
 }
 
 Idx Model::nx() const{
@@ -242,35 +603,85 @@ Idx Model::np() const{
 // 
 
 void Model::setEvals(const double* x){
-    cstack.setX(x);
-    obj->setEvals(cstack);
-    FOREACH(constraint, constraints)
-    //for (auto& constraint: constraints){
-        constraint->setEvals(cstack);
+    PhaseTimer timer(phaseStats(ModelStats::FORWARD), perfCounters());
+    setX(x, true);
+    evalObj(0, nullptr);
+    evalConstraints(0, nullptr);
+}
+
+void Model::setEvalCacheBudget(size_t bytes){
+    eval_cache.setBudget(bytes);
+    cache_entry = nullptr;
+}
+
+const EvalCache& Model::getEvalCache()const{
+    return eval_cache;
+}
+
+void Model::clearEvalCache(){
+    eval_cache.clear();
+    cache_entry = nullptr;
+    last_x.clear();
+    var_rows_start.clear();
+}
+
+void Model::setIncrementalEvals(bool s){
+    incremental = s;
+    last_x.clear();
+    if (not incremental){
+        row_order.clear();
+        jac_store.clear();
+        grad_store.clear();
+        var_rows_start.clear();
+        var_rows.clear();
+        in_obj.clear();
     }
 }
 
+bool Model::incrementalEvals()const{
+    return incremental;
+}
+
 void Model::eval_f(const double* x, bool new_x, double& obj_value){
-    if (new_x) setEvals(x);
+    PhaseTimer timer(phaseStats(ModelStats::FORWARD), perfCounters());
+    setX(x, new_x);
+    if (obj_order < 0)
+        evalObj(0, nullptr);
     obj_value = obj->getG();
     VALGRIND_CONDITIONAL_JUMP_TEST(obj_value);
 }
 
 void Model::eval_grad_f(const double* x, bool new_x, double* grad_f){
-    if (new_x) setEvals(x);
+    PhaseTimer timer(phaseStats(ModelStats::JACOBIAN), perfCounters());
+    setX(x, new_x);
     for (Idx i=0; i<nx(); i++)
         grad_f[i] = 0;
-
-    Idx i=0;
-    FOREACH(value, obj->getJac())
-    //for (auto& value: obj->getJac()){
-        VALGRIND_CONDITIONAL_JUMP_TEST(value);
-        grad_f[obj_jac_map[i++]] = value;
+    if (incremental){
+        evalObj(derivativeOrder(), nullptr);
+        for (Idx i=0; i<grad_store.size(); i++)
+            grad_f[obj_jac_map[i]] = grad_store[i];
+        return;
+    }
+    if (cache_entry != nullptr && cache_entry->has_grad){
+        const auto& grad = cache_entry->grad;
+        for (Idx i=0; i<grad.size(); i++)
+            grad_f[obj_jac_map[i]] = grad[i];
+        return;
+    }
+    evalObj(derivativeOrder(), grad_f);
+    if (cache_entry != nullptr){
+        auto& grad = cache_entry->grad;
+        for (Idx i=0; i<grad.size(); i++)
+            grad[i] = grad_f[obj_jac_map[i]];
+        cache_entry->has_grad = true;
     }
 }
 
 void Model::eval_g(const double* x, bool new_x, double* g){
-    if (new_x) setEvals(x);
+    PhaseTimer timer(phaseStats(ModelStats::FORWARD), perfCounters());
+    setX(x, new_x);
+    if (con_order < 0)
+        evalConstraints(0, nullptr);
     for (Idx i=0; i<ng(); i++){
         g[i] = constraints[i]->getG();
         VALGRIND_CONDITIONAL_JUMP_TEST(g[i]);
@@ -278,26 +689,468 @@ void Model::eval_g(const double* x, bool new_x, double* g){
 }
 
 void Model::eval_jac_g(const double* x, bool new_x, double* values){
-    if (new_x) setEvals(x);
-    int nz = 0;
-    FOREACH(constraint, constraints)
-    //for (auto& constraint: constraints){
-        auto& jac = constraint->getJac();
-        std::copy(jac.begin(), jac.end(), &(values[nz]));
-        nz += jac.size();
+    PhaseTimer timer(phaseStats(ModelStats::JACOBIAN), perfCounters());
+    setX(x, new_x);
+    if (incremental){
+        evalConstraints(derivativeOrder(), values);
+        return;
+    }
+    if (cache_entry != nullptr && cache_entry->has_jac){
+        std::copy(cache_entry->jac.begin(), cache_entry->jac.end(), values);
+        return;
+    }
+    evalConstraints(derivativeOrder(), values);
+    if (cache_entry != nullptr){
+        std::copy(values, &(values[getNNZ_Jac()]), cache_entry->jac.begin());
+        cache_entry->has_jac = true;
     }
 }
 
 void Model::eval_h(const double* x, bool new_x, double* values, double obj_factor, const double* lambda){
-    if (new_x) setEvals(x);
+    PhaseTimer timer(phaseStats(ModelStats::HESSIAN), perfCounters());
+    setX(x, new_x);
+    TIMELINE_SCOPE("evalHessian");
 
     for (Idx i=0; i<hess_pos_map.size(); i++)
         values[i] = 0;
 
+    if (not hess_skipping){
+        if (con_order < 2)
+            evalConstraints(2, nullptr);
+        if (obj_order < 2)
+            evalObj(2, nullptr);
+
+        bool sampled = samplePass();
+        for (Idx i=0; i<ng(); i++)
+            profileRow(i, sampled, [&](){
+                    constraints[i]->eval_h(values, lambda[i]); });
+
+        profileRow(ng(), sampled, [&](){ obj->eval_h(values, obj_factor); });
+        hess_evaluated += ng() + 1;
+        return;
+    }
+
+    cstack.setOrder(2);
+    bool sampled = samplePass();
     for (Idx i=0; i<ng(); i++)
-        constraints[i]->eval_h(values, lambda[i]);
+        profileRow(i, sampled, [&](){ evalHessRow(constraints[i], values,
+                    lambda[i], hess_skip_threshold); });
+    profileRow(ng(), sampled, [&](){ evalHessRow(obj, values, obj_factor, 0); });
+}
+
+void Model::setX(const double* x, bool new_x){
+    finalizeConstraints();
+    updateEvalPool();
+    cstack.setX(x);
+    if (param_changes != params.changes()){
+        // all evaluations are outdated
+        param_changes = params.changes();
+        clearEvalCache();
+        new_x = true;
+    }
+    if (not new_x)
+        return;
+    if (incremental){
+        markChangedRows(x);
+        return;
+    }
+    con_order = -1;
+    obj_order = -1;
+    cache_entry = nullptr;
+    if (eval_cache.getBudget() == 0 || uncachable_rows > 0)
+        return;
+    bool hit;
+    cache_entry = eval_cache.lookup(x, nx(), cache_rows, getNNZ_Jac(),
+            obj_jac_map.size(), hit);
+    if (hit)
+        loadCacheEntry();
+}
+
+void Model::loadCacheEntry(){
+    con_order = cache_entry->con_order;
+    obj_order = cache_entry->obj_order;
+    const double* data = cache_entry->rows.data();
+    if (obj_order >= 0)
+        obj->loadEvals(data);
+    if (con_order < 0)
+        return;
+    data += obj->evalsSize();
+    for (Idx i=0; i<ng(); i++){
+        constraints[i]->loadEvals(data);
+        data += constraints[i]->evalsSize();
+    }
+}
+
+void Model::saveCacheRows(const bool& cons){
+    double* data = cache_entry->rows.data();
+    if (not cons){
+        obj->saveEvals(data);
+        cache_entry->obj_order = obj_order;
+        return;
+    }
+    data += obj->evalsSize();
+    for (Idx i=0; i<ng(); i++){
+        constraints[i]->saveEvals(data);
+        data += constraints[i]->evalsSize();
+    }
+    cache_entry->con_order = con_order;
+}
+
+void Model::markChangedRows(const double* x){
+    if (last_x.size() != nx()){
+        last_x.assign(x, &(x[nx()]));
+        row_order.assign(ng(), -1);
+        jac_store.resize(getNNZ_Jac());
+        grad_store.resize(obj_jac_map.size());
+        con_order = -1;
+        obj_order = -1;
+        return;
+    }
+    if (var_rows_start.empty())
+        buildIncidence();
+
+    bool con_changed = false;
+    bool obj_changed = false;
+    for (Idx i=0; i<nx(); i++){
+        if (last_x[i] == x[i])
+            continue;
+        last_x[i] = x[i];
+        obj_changed = obj_changed || in_obj[i];
+        for (Idx k=var_rows_start[i]; k<var_rows_start[i+1]; k++){
+            row_order[var_rows[k]] = -1;
+            con_changed = true;
+        }
+    }
+    if (con_changed)
+        con_order = -1;
+    if (obj_changed)
+        obj_order = -1;
+}
+
+void Model::buildIncidence(){
+    TRACE_START;
+    vector<unsigned int> cols(getNNZ_Jac());
+    for (Idx i=0; i<ng(); i++)
+        constraints[i]->getNZ_Jac(&(cols.data()[jac_offsets[i]]));
+
+    var_rows_start.assign(nx()+1, 0);
+    for (Idx k=0; k<cols.size(); k++)
+        var_rows_start[cols[k]+1]++;
+    for (Idx i=0; i<nx(); i++)
+        var_rows_start[i+1] += var_rows_start[i];
+
+    vector<Idx> pos(var_rows_start.begin(), var_rows_start.end()-1);
+    var_rows.resize(cols.size());
+    for (Idx i=0; i<ng(); i++)
+        for (Idx k=jac_offsets[i]; k<jac_offsets[i+1]; k++)
+            var_rows[pos[cols[k]]++] = i;
+
+    in_obj.assign(nx(), false);
+    FOREACH(id, obj_jac_map)
+        in_obj[id] = true;
+    }
+    TRACE_END;
+}
+
+int Model::derivativeOrder()const{
+    return hess_skipping ? 1 : 2;
+}
+
+void Model::evalObj(const int& order, double* grad_f){
+    TIMELINE_SCOPE("evalObj");
+    cstack.setOrder(order);
+    bool sampled = samplePass();
+    if (incremental){
+        if (obj_order < order)
+            profileRow(ng(), sampled, [&](){
+                    obj->setEvals(cstack, grad_store.data(), nullptr); });
+    } else
+        profileRow(ng(), sampled, [&](){
+                obj->setEvals(cstack, grad_f, obj_jac_map.data()); });
+    obj_order = max(obj_order, order);
+    if (cache_entry != nullptr)
+        saveCacheRows(false);
+}
+
+void Model::evalConstraints(const int& order, double* jac_values){
+    TIMELINE_SCOPE("evalConstraints");
+    cstack.setOrder(order);
+    bool sampled = samplePass();
+    if (incremental){
+        for (Idx i=0; i<ng(); i++)
+            if (row_order[i] < order){
+                profileRow(i, sampled, [&](){
+                        constraints[i]->setEvals(cstack,
+                            &(jac_store.data()[jac_offsets[i]]), nullptr); });
+                row_order[i] = order;
+            }
+        if (jac_values != nullptr)
+            std::copy(jac_store.begin(), jac_store.end(), jac_values);
+        con_order = max(con_order, order);
+        return;
+    }
+    for (Idx i=0; i<ng(); i++){
+        double* jac = nullptr;
+        if (jac_values != nullptr)
+            jac = &(jac_values[jac_offsets[i]]);
+        profileRow(i, sampled, [&](){
+                constraints[i]->setEvals(cstack, jac, nullptr); });
+    }
+    con_order = max(con_order, order);
+    if (cache_entry != nullptr)
+        saveCacheRows(true);
+}
+
+bool Model::samplePass(){
+    if (profile_every == 0)
+        return false;
+    if (profile_time.size() != ng() + 1)
+        resetConstraintProfile();
+    return profile_passes++ % profile_every == 0;
+}
+
+template<class F>
+void Model::profileRow(const Idx& row, const bool& sampled, F f){
+    if (not sampled){
+        f();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    f();
+    profile_time[row] += std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    profile_samples[row]++;
+}
+
+void Model::profileConstraints(Idx every){
+    profile_every = every;
+    profile_passes = 0;
+}
+
+void Model::resetConstraintProfile(){
+    profile_time.assign(ng() + 1, 0);
+    profile_samples.assign(ng() + 1, 0);
+}
+
+vector<ConstraintProfile> Model::constraintProfile(Idx top,
+        size_t max_expr_length){
+    vector<Idx> rows;
+    for (Idx i=0; i<profile_samples.size(); i++)
+        if (profile_samples[i] > 0)
+            rows.push_back(i);
+    top = std::min<Idx>(top, rows.size());
+    std::partial_sort(rows.begin(), rows.begin() + top, rows.end(),
+            [&](const Idx& a, const Idx& b){
+                return profile_time[a] > profile_time[b];
+            });
+    rows.resize(top);
+
+    vector<ConstraintProfile> res;
+    FOREACH(row, rows)
+        ConstraintProfile p;
+        p.objective = row == ng();
+        ConstraintInterface* con = p.objective ? obj : constraints[row];
+        if (not p.objective)
+            p.constraint = Constraint(this, row);
+        p.row = row;
+        p.time = profile_time[row];
+        p.samples = profile_samples[row];
+        p.nnz_jac = con->getNNZ_Jac();
+        auto inner = dynamic_cast<InnerConstraint*>(con);
+        if (inner != nullptr){
+            p.tape_size = inner->tapeSize();
+            p.nnz_hess = inner->getNNZ_Hess();
+            p.nof_conflicts = inner->nofConflicts();
+            p.expr = inner->toString(vars);
+        } else {
+            p.tape_size = 0;
+            p.nnz_hess = 0;
+            p.nof_conflicts = 0;
+            p.expr = "custom constraint";
+        }
+        if (p.expr.size() > max_expr_length)
+            p.expr = p.expr.substr(0, max_expr_length) + "...";
+        res.push_back(p);
+    }
+    return res;
+}
+
+MemoryReport Model::memoryReport()const{
+    MemoryReport r;
+    r.vars = vars.memory();
+    r.params = params.memory();
+    r.constraints = obj->memory() + MadOpt::memory(constraints)
+        + MadOpt::memory(pending);
+    FOREACH(con, constraints)
+        r.constraints += con->memory();
+    }
+    r.tapes = arena.tapeMemory();
+    r.jac_hess = arena.mapMemory() + MadOpt::memory(jac_offsets)
+        + MadOpt::memory(obj_jac_map);
+    r.stacks = cstack.memory() + simstack.memory();
+    FOREACH(stack, eval_stacks)
+        r.stacks += stack.memory();
+    }
+    r.hash_maps = MadOpt::memory(hess_pos_map);
+    r.eval_cache = eval_cache.memory() + MadOpt::memory(last_x)
+        + MadOpt::memory(row_order) + MadOpt::memory(jac_store)
+        + MadOpt::memory(grad_store) + MadOpt::memory(var_rows_start)
+        + MadOpt::memory(var_rows) + MadOpt::memory(in_obj)
+        + MadOpt::memory(profile_time) + MadOpt::memory(profile_samples);
+    r.solution = solution.memory();
+    r.file_backed = arena.fileBacked() ? arena.memory() : 0;
+
+    // second field of statm is the resident set in pages
+    size_t pages = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> pages;
+    r.process_rss = statm ? pages*sysconf(_SC_PAGESIZE) : 0;
+    return r;
+}
 
-    obj->eval_h(values, obj_factor);
+static Distribution distribution(const vector<Idx>& counts){
+    Distribution d;
+    if (counts.empty())
+        return d;
+    d.min = counts[0];
+    double sum = 0;
+    FOREACH(c, counts)
+        d.min = std::min(d.min, c);
+        d.max = std::max(d.max, c);
+        sum += c;
+        Idx bucket = 0;
+        for (Idx v=c; v>0; v/=2)
+            bucket++;
+        if (d.histogram.size() <= bucket)
+            d.histogram.resize(bucket + 1, 0);
+        d.histogram[bucket]++;
+    }
+    d.mean = sum / counts.size();
+    return d;
+}
+
+ModelAnalysis Model::analyze(){
+    TRACE_START;
+    finalizeConstraints();
+    static const std::map<OPType, string> names = {{OP_VAR_IDX, "var"},
+        {OP_CONST, "const"}, {OP_PARAM_POINTER, "param"},
+        {OP_PARAM_SLOT, "param_expr"}, {OP_ADD, "add"}, {OP_MUL, "mul"},
+        {OP_POW, "pow"}, {OP_SIN, "sin"}, {OP_COS, "cos"}, {OP_TAN, "tan"},
+        {OP_LOG2, "log2"}, {OP_LN, "ln"}, {OP_SQR, "sqr"},
+        {OP_IPOW, "ipow"}, {OP_INV, "inv"}, {OP_SQRT, "sqrt"},
+        {OP_EXP, "exp"}, {OP_DIV, "div"}};
+
+    ModelAnalysis a;
+    a.nx = nx();
+    a.ng = ng();
+    a.nnz_jac = getNNZ_Jac();
+    a.nnz_hess = getNNZ_Hess();
+    if (nx() > 0)
+        a.hess_density = a.nnz_hess / (0.5*nx()*(nx() + 1.0));
+
+    vector<Idx> op_counts, lengths, depths, conflicts, jac_row;
+    vector<Idx> jac_col(nx(), 0);
+    vector<unsigned int> cols;
+    std::unordered_set<size_t> shapes;
+    for (Idx row=0; row<=ng(); row++){
+        ConstraintInterface* con = row < ng() ? constraints[row] : obj;
+        Idx nnz = con->getNNZ_Jac();
+        jac_row.push_back(nnz);
+        cols.resize(nnz);
+        con->getNZ_Jac(cols.data());
+        FOREACH(col, cols)
+            jac_col[col]++;
+        }
+
+        auto inner = dynamic_cast<InnerConstraint*>(con);
+        if (inner == nullptr){
+            a.custom++;
+            continue;
+        }
+        auto stats = inner->tapeStats(op_counts);
+        lengths.push_back(inner->tapeSize());
+        depths.push_back(stats.depth);
+        conflicts.push_back(inner->nofConflicts());
+        if (stats.degree < 0 || stats.degree > 2)
+            a.nonlinear++;
+        else if (stats.degree == 2)
+            a.quadratic++;
+        else
+            a.linear++;
+        if (row == ng())
+            a.objective_degree = stats.degree;
+        if (not shapes.insert(stats.shape).second)
+            a.identical++;
+    }
+    a.shapes = shapes.size();
+    for (Idx type=0; type<op_counts.size(); type++)
+        if (op_counts[type] > 0){
+            auto name = names.find(type);
+            a.opcodes[name != names.end() ? name->second
+                : "op" + std::to_string(type)] = op_counts[type];
+        }
+    a.tape_length = distribution(lengths);
+    a.tape_depth = distribution(depths);
+    a.conflicts = distribution(conflicts);
+    a.jac_row = distribution(jac_row);
+    a.jac_col = distribution(jac_col);
+    TRACE_END;
+    return a;
+}
+
+void Model::evalHessRow(ConstraintInterface* con, double* values,
+        const double& factor, const double& threshold){
+    if (factor == 0 || std::fabs(factor) < threshold){
+        hess_skipped++;
+        return;
+    }
+    con->setEvals(cstack, nullptr, nullptr);
+    con->eval_h(values, factor);
+    hess_evaluated++;
+}
+
+size_t Model::nofSkippedHessRows()const{
+    return hess_skipped;
+}
+
+size_t Model::nofEvaluatedHessRows()const{
+    return hess_evaluated;
+}
+
+void Model::resetHessCounters(){
+    hess_skipped = 0;
+    hess_evaluated = 0;
+}
+
+const ModelStats& Model::stats()const{
+    return model_stats;
+}
+
+void Model::resetStats(){
+    model_stats = ModelStats();
+}
+
+CallbackStats* Model::callbackStats(const ModelStats::Callback& callback){
+    return collect_stats ? &model_stats[callback] : nullptr;
+}
+
+PhaseStats* Model::phaseStats(const ModelStats::Phase& phase){
+    return collect_stats ? &model_stats.phases[phase] : nullptr;
+}
+
+const PerfCounterSet* Model::perfCounters(){
+    if (not collect_stats)
+        return nullptr;
+    // counters count only the threads they were opened for, phases do not
+    // nest, so no PhaseTimer uses the set that is replaced
+    if (not perf_counters or not perf_counters->owner()
+            or perf_pool_start != eval_pool_starts){
+        perf_counters.reset(new PerfCounterSet(eval_pool != nullptr ?
+                    eval_pool->threadIds() : vector<long>()));
+        perf_pool_start = eval_pool_starts;
+    }
+    model_stats.hardware_counters = perf_counters->available();
+    return perf_counters->available() ? perf_counters.get() : nullptr;
 }
 
 double Model::objValue()const { 
@@ -310,9 +1163,8 @@ Solution::SolverStatus Model::status()const {
 
 Var Model::addVar(double lb, double ub, VarType type, double init, string name){
     TRACE_START;
-    InnerVar* v = new InnerVar(lb, ub, init, type, name, solution);
-    v->setPos(vars.size());
-    vars.push_back(v);
+    clearEvalCache();
+    InnerVar* v = vars.add(lb, ub, init, type, keep_names ? name : "");
     model_changed = true;
     TRACE_END;
     return Var(v);
@@ -320,8 +1172,7 @@ Var Model::addVar(double lb, double ub, VarType type, double init, string name){
 
 Param Model::addParam(const double value, const string name){
     TRACE_START;
-    InnerParam* p = new InnerParam(value, name);
-    params.push_back(p);
+    InnerParam* p = params.add(value, keep_names ? name : "");
     TRACE_END;
     return Param(p);
 }
@@ -332,10 +1183,8 @@ bool Model::hasSolution() const{
 
 const string Model::toString()const {
     string res;
-    FOREACH(var, vars)
-    //for (auto& var : vars){
-        res += var->toString() + "\n";
-    }
+    for (Idx i=0; i<nx(); i++)
+        res += vars[i]->toString() + "\n";
 
 //    for (auto constraint: constraints)
 //        res += constraint->toString() + "\n";
@@ -16,25 +16,158 @@
 #ifndef MADOPT_MODEL_H
 #define MADOPT_MODEL_H
 
+#include <functional>
+#include <map>
 #include "common.hpp"
 
 #include "cstack.hpp"
 #include "simstack.hpp"
+#include "inner_var.hpp"
+#include "inner_param.hpp"
 #include "var.hpp"
 #include "param.hpp"
 #include "constraint.hpp"
 #include "solution.hpp"
 #include "constraint_interface.hpp"
+#include "eval_cache.hpp"
+#include "callback_stats.hpp"
+#include "threadpool.hpp"
 
 namespace MadOpt {
 
-//class ThreadPool;
+//! sampled evaluation cost of a constraint, \sa Model::constraintProfile()
+struct ConstraintProfile {
+    //! handle of the constraint, not valid for the objective
+    Constraint constraint;
+    //! position of the constraint, Model::ng() for the objective
+    Idx row;
+    bool objective;
+    //! cumulative wall time of the sampled evaluations in seconds
+    double time;
+    //! number of sampled evaluations
+    Idx samples;
+    //! \sa InnerConstraint::tapeSize(), 0 for custom constraints
+    Idx tape_size;
+    Idx nnz_jac;
+    Idx nnz_hess;
+    //! \sa InnerConstraint::nofConflicts()
+    Idx nof_conflicts;
+    //! the expression, truncated
+    string expr;
+};
+
+/*! \brief bytes allocated by the parts of a model, \sa Model::memoryReport()
+ * \details expressions held by the user, e.g. an Expr that is built but not
+ * added yet, are not part of the model and not counted
+ */
+struct MemoryReport {
+    //! variable handles, bounds, initial values and names
+    size_t vars;
+    //! parameters and names
+    size_t params;
+    //! constraint objects including the objective and its own arena
+    size_t constraints;
+    //! operators, operands and constants of the compiled tapes
+    size_t tapes;
+    //! jacobian entries, hessian maps and values, conflicts and parameter
+    //slots in the arena, jacobian offsets and the objective gradient map
+    size_t jac_hess;
+    //! evaluation stacks, sized by the symbolic analysis
+    size_t stacks;
+    //! the map of hessian entries to their position
+    size_t hash_maps;
+    //! evaluation cache, incremental evaluation stores and profiler samples
+    size_t eval_cache;
+    //! primal and dual values of the solution
+    size_t solution;
+    //! the part of the above in memory mapped files, \sa
+    //Model::mapConstraintData()
+    size_t file_backed;
+    //! resident set size of the process, 0 if unknown, the part not covered
+    //by total() belongs to e.g. the solver or user expressions
+    size_t process_rss;
+
+    //! bytes of all model parts
+    size_t total()const {
+        return vars + params + constraints + tapes + jac_hess + stacks
+            + hash_maps + eval_cache + solution;
+    }
+};
+
+//! distribution of a count over rows or columns, \sa ModelAnalysis
+struct Distribution {
+    Distribution(): min(0), max(0), mean(0){}
+
+    Idx min;
+    Idx max;
+    double mean;
+    //! histogram[0] is the number of zero counts, histogram[k] the number of
+    //counts from 2^(k-1) to 2^k-1
+    vector<Idx> histogram;
+};
+
+/*! \brief structure of a model, \sa Model::analyze()
+ * \details the rows are the constraints followed by the objective, rows
+ * that are no Expr based constraints are counted as custom and left out
+ * of the tape statistics
+ */
+struct ModelAnalysis {
+    ModelAnalysis(): nx(0), ng(0), nnz_jac(0), nnz_hess(0), hess_density(0),
+        linear(0), quadratic(0), nonlinear(0), custom(0), objective_degree(-1),
+        shapes(0), identical(0){}
+
+    Idx nx;
+    Idx ng;
+    //! operators of all tapes by name, e.g. "add", "mul", "sin"
+    std::map<string, Idx> opcodes;
+    //! operators per tape
+    Distribution tape_length;
+    //! depth of the expression trees
+    Distribution tape_depth;
+    //! jacobian nonzeros per row, the objective gradient included
+    Distribution jac_row;
+    //! jacobian nonzeros per variable, the objective gradient included
+    Distribution jac_col;
+    //! length of the conflict lists of the hessian sweeps
+    Distribution conflicts;
+    //! constraint jacobian nonzeros
+    Idx nnz_jac;
+    //! lower triangle hessian nonzeros
+    Idx nnz_hess;
+    //! nnz_hess of the nx*(nx+1)/2 entries of the lower triangle
+    double hess_density;
+    //! rows by their polynomial degree, up to 1, 2 and higher or no
+    //polynomial
+    Idx linear;
+    Idx quadratic;
+    Idx nonlinear;
+    Idx custom;
+    //! \sa InnerConstraint::TapeStats::degree
+    int objective_degree;
+    //! number of distinct tapes up to their variables, constants and
+    //parameters
+    Idx shapes;
+    //! rows with the same tape as an earlier row, up to their variables,
+    //constants and parameters
+    Idx identical;
+};
 
 //! generic Model class, not for direct use hence the constructor is protected
 class Model {
     public:
-        Model(): show_solver(false), timelimit(-1), model_changed(false),
-                 obj(new InnerConstraint(Expr(0), 0, 0, hess_pos_map, simstack)){}
+        Model(): show_solver(false), timelimit(-1), keep_names(true),
+                 hess_skipping(false),
+                 hess_skip_threshold(0), symbolic_threads(0),
+                 eval_threads(1), split_terms(10000),
+                 collect_stats(false),
+                 model_changed(false), vars(solution),
+                 obj(new InnerConstraint(Expr(0), 0, 0, hess_pos_map, simstack)),
+                 hess_skipped(0), hess_evaluated(0),
+                 con_order(-1), obj_order(-1), jac_offsets(1, 0),
+                 cache_rows(1), uncachable_rows(0), cache_entry(nullptr),
+                 incremental(false), param_changes(0),
+                 profile_every(0), profile_passes(0), perf_pool_start(0),
+                 eval_pool_starts(0){}
 
   Model(Model const &) = delete;
   Model(Model&&) = delete;
@@ -148,6 +281,31 @@ class Model {
         */
         Constraint addConstr(ConstraintInterface* con);
 
+        /*! \brief add the constraints lbs[i] <= exprs[i] <= ubs[i]
+         * \details the symbolic analysis of the constraints is deferred to
+         * finalizeConstraints(), which runs it for all of them in one pass
+         * before the model structure is needed, e.g. by solve()
+         */
+        vector<Constraint> addConstrs(const vector<double>& lbs,
+                const vector<Expr>& exprs, const vector<double>& ubs);
+
+        /*! \brief add n constraints build by builder(i, lb, ub)
+         * \details builder returns the expression of the i-th constraint and
+         * sets its bounds, \sa addConstrs()
+         */
+        vector<Constraint> addConstrs(const Idx& n,
+                const std::function<Expr(const Idx&, double&, double&)>& builder);
+
+        //! run the symbolic analysis of the constraints added by addConstrs()
+        void finalizeConstraints();
+
+        /*! \brief add the constraint lb <= tape <= ub
+         * \details the tape is compiled as it is, its analysis is deferred
+         * as the one of addConstrs(), \sa NLReader
+         */
+        Constraint addConstr(const double lb, InnerConstraint::Tape tape,
+                const double ub);
+
         //Objective Stuff
         /*! set objective based on custom objective implementation that is
          * derived from InnerConstraint
@@ -157,6 +315,15 @@ class Model {
         //! set objective based on Expr 
         void setObj(const Expr& expr);
 
+        //! set objective based on a tape, \sa addConstr(const double,
+        //InnerConstraint::Tape, const double)
+        void setObj(InnerConstraint::Tape tape);
+
+        /*! \brief adds the variables, constraints and objective of an AMPL
+         * .nl file to the model, \sa NLReader
+         */
+        void readNL(const string& path);
+
         //NLP init stuff
         Idx getNNZ_Jac();
         Idx getNNZ_Hess();
@@ -168,6 +335,29 @@ class Model {
         //! set the currently loaded solution as initial values, 
         void solAsInit();
 
+        /*! \brief writes the compiled model to a binary file
+         * \details the file keeps the variables, parameters, the compiled
+         * constraints and objective including their jacobian and hessian
+         * structure, only constraints based on Expr can be saved
+         */
+        void save(const string& path);
+
+        /*! \brief loads a model written by save() into this empty model
+         * \details the file is memory mapped while it is read, its arrays
+         * are copied into the model. The compiled constraints are used as
+         * they are, neither expressions are built nor the symbolic analysis
+         * is run, but their indices and conflicts are checked in one pass
+         * over the tapes. Throws if the file is corrupt, the model stays
+         * empty then.
+         */
+        void load(const string& path);
+
+        //! variable at position pos, e.g. of a loaded model
+        Var getVar(const Idx& pos);
+
+        //! parameter with index idx, e.g. of a loaded model
+        Param getParam(const Idx& idx);
+
         //! number of variables
         Idx nx() const;
 
@@ -178,6 +368,12 @@ class Model {
         Idx np() const;
 
         // Eval functions
+        //
+        // the evaluation does not allocate after the first call, only the
+        // eval cache allocates while it fills up to its budget, see
+        // tests/alloc_tests.hpp
+
+        //! loads the point x and computes the values of all rows
         void setEvals(const double* x);
         void eval_f(const double* x, bool new_x, double& obj_value);
         void eval_grad_f(const double* x, bool new_x, double* grad_f);
@@ -207,7 +403,118 @@ class Model {
         //! timelimit, a negative value is interpreted as no time limit
         double timelimit;
 
-        const vector<InnerVar*>& getVars()const { return vars; }
+        //! if false, the names of new variables and parameters are dropped
+        //and generated from their index on access instead
+        bool keep_names;
+
+        /*! \brief if true, the hessian is only computed in eval_h and only
+         * for rows with a multiplier that is not negligible
+         * \details the objective is skipped if obj_factor is 0, a constraint
+         * is skipped if its lambda is 0 or its absolute value is below
+         * hess_skip_threshold
+         */
+        bool hess_skipping;
+
+        //! \sa hess_skipping
+        double hess_skip_threshold;
+
+        //! number of threads finalizeConstraints() uses for the symbolic
+        //analysis, 0 uses one per hardware thread
+        Idx symbolic_threads;
+
+        /*! \brief number of threads evaluating a wide sum at the root of a
+         * constraint or the objective, 0 uses one per hardware thread
+         * \details the sum is split into chunks of at least split_terms
+         * terms when the constraint is added or the objective is set, the
+         * chunks are evaluated in parallel and their derivatives summed up
+         * by a parallel reduction. 1 (default) disables it.
+         */
+        Idx eval_threads;
+
+        //! \sa eval_threads
+        Idx split_terms;
+
+        /*! \brief if true, the solver callbacks record their calls and wall
+         * time into stats()
+         * \details the evaluation phases record their wall time and, if
+         * perf events are available, cycles, instructions, cache and branch
+         * misses of the evaluating thread and the eval_threads workers,
+         * \sa ModelStats::Phase
+         */
+        bool collect_stats;
+
+        //! number of rows (constraints and objective) eval_h has skipped
+        size_t nofSkippedHessRows()const;
+
+        //! number of rows (constraints and objective) eval_h has evaluated
+        size_t nofEvaluatedHessRows()const;
+
+        //! resets the hessian row counters
+        void resetHessCounters();
+
+        /*! \brief call statistics of the solver callbacks and the solve time
+         * since the last resetStats(), only recorded while collect_stats is
+         * true
+         */
+        const ModelStats& stats()const;
+
+        //! resets stats()
+        void resetStats();
+
+        //! the statistics a solver interface records callback into, nullptr
+        //if collect_stats is false
+        CallbackStats* callbackStats(const ModelStats::Callback& callback);
+
+        /*! \brief samples the wall time of each constraint and the objective
+         * in every every-th evaluation pass, 0 (default) disables it
+         * \details a pass is the evaluation of all constraints, of the
+         * objective or the hessian, a row is timed including its derivatives
+         * the callback needs. The samples are dropped if the number of
+         * constraints changes, \sa constraintProfile()
+         */
+        void profileConstraints(Idx every);
+
+        //! the top rows by sampled time, with their expression truncated to
+        //max_expr_length characters
+        vector<ConstraintProfile> constraintProfile(Idx top,
+                size_t max_expr_length=80);
+
+        //! drops the samples of profileConstraints()
+        void resetConstraintProfile();
+
+        //! bytes allocated by the parts of the model, \sa MemoryReport
+        MemoryReport memoryReport()const;
+
+        //! operators, tape shapes and sparsity of the model, \sa
+        //ModelAnalysis
+        ModelAnalysis analyze();
+
+        /*! \brief sets the memory budget in bytes of the evaluation cache
+         * \details the cache keeps the values, jacobian and hessian of
+         * recently evaluated points, a point that is evaluated again is
+         * loaded from the cache, 0 (default) disables the cache
+         */
+        void setEvalCacheBudget(size_t bytes);
+
+        //! the evaluation cache, to access its statistics
+        const EvalCache& getEvalCache()const;
+
+        //! removes all cached evaluations, including the reference point of
+        //incremental evaluations
+        void clearEvalCache();
+
+        /*! \brief enable/disable incremental evaluations
+         * \details if enabled, a new point is compared to the last one and
+         * only rows that depend on changed variables are evaluated again,
+         * the other rows keep their values, jacobian and hessian. The
+         * evaluation cache is not used in this mode.
+         */
+        void setIncrementalEvals(bool s);
+
+        //! \sa setIncrementalEvals()
+        bool incrementalEvals()const;
+
+        const VarPool& getVars()const { return vars; }
 
         double lb(Idx idx) const;
         void lb(Idx idx, double v);
@@ -217,24 +524,156 @@ class Model {
 
         const string toString()const;
 
+        /*! \brief keeps the compiled constraints in memory mapped files in
+         * dir, for models that do not fit into memory
+         * \details the data of the constraints that exist and that are
+         * added later is paged in while the constraints are evaluated,
+         * \sa ConstraintArena::mapToFiles()
+         */
+        void mapConstraintData(const string& dir);
+
+        const ConstraintArena& getArena()const { return arena; }
+
         SimStack& getSimStack(){ return simstack; }
         CStack& getCStack(){ return cstack; }
 
     protected:
         bool model_changed;
-        vector<InnerVar*> vars;
-  Solution solution;
+        Solution solution;
+        VarPool vars;
+        //! \sa stats(), solve() of the solvers adds its solve_time
+        ModelStats model_stats;
 
     private:
-        vector<InnerParam*> params;
+        ParamPool params;
         vector<ConstraintInterface*> constraints;
+        //! storage of the InnerConstraints in constraints
+        ConstraintArena arena;
         CStack cstack;
         SimStack simstack;
+        //! declared before obj, which keeps a reference to it
+        HessPosMap hess_pos_map;
         ConstraintInterface* obj;
         vector<Idx> obj_jac_map;
-        HessPosMap hess_pos_map;
+        size_t hess_skipped;
+        size_t hess_evaluated;
+
+        //! highest derivative order computed at the current point, -1 if
+        //nothing is computed yet, the jacobian itself is not kept but
+        //written to the solvers buffer
+        int con_order;
+        int obj_order;
+
+        //! position of the first jacobian value of each constraint in the
+        //solvers buffer, the last element is the number of nonzeros
+        vector<Idx> jac_offsets;
+
+        EvalCache eval_cache;
+        //! size of EvalCache::Entry::rows
+        Idx cache_rows;
+        //! number of rows that do not support caching
+        Idx uncachable_rows;
+        //! cache entry of the current point, nullptr if not cached
+        EvalCache::Entry* cache_entry;
+
+        bool incremental;
+        //! point of the last incremental evaluation, empty if there is none
+        vector<double> last_x;
+        //! highest derivative order computed for each constraint at last_x
+        vector<int> row_order;
+        //! constraint jacobian and objective gradient kept for incremental
+        //evaluations
+        vector<double> jac_store;
+        vector<double> grad_store;
+        //! constraints that depend on variable i are
+        //var_rows[var_rows_start[i]] to var_rows[var_rows_start[i+1]-1]
+        vector<Idx> var_rows_start;
+        vector<Idx> var_rows;
+        //! true for variables the objective depends on
+        vector<bool> in_obj;
+
+        //! ParamPool::changes() seen by the last setX() call
+        size_t param_changes;
+
+        //! \sa profileConstraints()
+        Idx profile_every;
+        Idx profile_passes;
+        //! sampled time and number of samples of each constraint, the
+        //objective is last
+        vector<double> profile_time;
+        vector<Idx> profile_samples;
+
+        //! \sa perfCounters()
+        std::unique_ptr<PerfCounterSet> perf_counters;
+        //! eval_pool_starts when perf_counters were opened
+        size_t perf_pool_start;
+
+        //! \sa eval_threads, worker i>0 of eval_pool evaluates with
+        //eval_stacks[i-1]
+        std::unique_ptr<ThreadPool> eval_pool;
+        vector<CStack> eval_stacks;
+        //! incremented whenever eval_pool is started or stopped
+        size_t eval_pool_starts;
+
+        //! constraints added by addConstrs() that are not analyzed yet, they
+        //are the last ones in constraints
+        vector<InnerConstraint*> pending;
+
+        void checkConstr(const double lb, const Expr& expr, const double ub);
+
+        void checkTape(const InnerConstraint::Tape& tape)const;
+
+        //! runs analyze() of the pending constraints on several threads
+        void analyzePending(Idx nof_threads);
+
+        //! eval_threads with 0 resolved
+        Idx evalThreads()const;
+
+        //! analyze() of con with the split of eval_threads
+        void analyzeConstr(InnerConstraint* con, SimStack& stack);
+
+        //! sizes cstack and eval_stacks to simstack
+        void resizeStacks();
+
+        //! starts or stops eval_pool if eval_threads changed
+        void updateEvalPool();
 
         Var addVar(double lb, double ub, VarType type, double init, string name);
+
+        void setX(const double* x, bool new_x);
+
+        int derivativeOrder()const;
+
+        void evalObj(const int& order, double* grad_f);
+
+        void evalConstraints(const int& order, double* jac_values);
+
+        void loadCacheEntry();
+
+        void markChangedRows(const double* x);
+
+        void buildIncidence();
+
+        void saveCacheRows(const bool& cons);
+
+        void evalHessRow(ConstraintInterface* con, double* values,
+                const double& factor, const double& threshold);
+
+        //! starts an evaluation pass, true if it is sampled
+        bool samplePass();
+
+        //! the statistics of an evaluation phase, nullptr if collect_stats
+        //is false
+        PhaseStats* phaseStats(const ModelStats::Phase& phase);
+
+        //! the hardware counters of the calling thread and the eval_pool
+        //workers, reopened if either changed, nullptr if collect_stats is
+        //false or they are not available
+        const PerfCounterSet* perfCounters();
+
+        //! runs f, which evaluates row, and records its time if sampled
+        template<class F>
+        void profileRow(const Idx& row, const bool& sampled, F f);
 };
 }
 #endif
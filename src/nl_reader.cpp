@@ -0,0 +1,526 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "nl_reader.hpp"
+#include "model.hpp"
+#include "operator.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <stdlib.h>
+
+namespace MadOpt {
+
+// operator codes of the .nl format
+#define NL_PLUS 0
+#define NL_MINUS 1
+#define NL_MULT 2
+#define NL_DIV 3
+#define NL_POW 5
+#define NL_UMINUS 16
+#define NL_TAN 38
+#define NL_SQRT 39
+#define NL_SIN 41
+#define NL_LOG10 42
+#define NL_LOG 43
+#define NL_EXP 44
+#define NL_COS 46
+#define NL_SUMLIST 54
+#define NL_1POW 74
+#define NL_2POW 75
+
+NLReader::NLReader(Model& model): model(model), in(nullptr), line_nr(0),
+    var_offset(0), n_vars(0), n_cons(0), n_objs(0), n_binary(0),
+    n_integer(0), nl_both(0), nl_cons(0), nl_objs(0), nl_int_both(0),
+    nl_int_cons(0), nl_int_objs(0), maximize(false){}
+
+void NLReader::read(const string& path){
+    std::ifstream file(path);
+    if (not file)
+        throw MadOptError("cannot open " + path);
+    read(file);
+}
+
+void NLReader::read(std::istream& stream){
+    TRACE_START;
+    in = &stream;
+    line_nr = 0;
+    var_offset = model.nx();
+    readHeader();
+    cons.assign(n_cons, Tape());
+    con_lbs.assign(n_cons, -INF);
+    con_ubs.assign(n_cons, INF);
+    lbs.assign(n_vars, -INF);
+    ubs.assign(n_vars, INF);
+    inits.assign(n_vars, 0);
+    obj = Tape();
+    maximize = false;
+    defined.clear();
+
+    Terms terms;
+    const char* p;
+    while ((p = nextLine()) != nullptr){
+        char segment = *p++;
+        switch (segment){
+            case 'C': {
+                long i = readInt(p);
+                if (i < 0 || i >= (long) n_cons)
+                    fail("unknown constraint");
+                readExpr(cons[i]);
+                break;
+            }
+            case 'O': {
+                long i = readInt(p);
+                maximize = maximize || (i == 0 && readInt(p) == 1);
+                Tape tape;
+                readExpr(tape);
+                if (i == 0)
+                    obj = std::move(tape);
+                break;
+            }
+            case 'V': {
+                long i = readInt(p);
+                long n = readInt(p);
+                if (i != (long) (n_vars + defined.size()))
+                    fail("defined variables have to be in order");
+                readTerms(terms, n);
+                Tape tape;
+                readExpr(tape);
+                addTerms(tape, terms);
+                defined.push_back(std::move(tape));
+                break;
+            }
+            case 'J': {
+                long i = readInt(p);
+                long n = readInt(p);
+                if (i < 0 || i >= (long) n_cons)
+                    fail("unknown constraint");
+                readTerms(terms, n);
+                addTerms(cons[i], terms);
+                break;
+            }
+            case 'G': {
+                long i = readInt(p);
+                long n = readInt(p);
+                readTerms(terms, n);
+                if (i == 0)
+                    addTerms(obj, terms);
+                break;
+            }
+            case 'x': {
+                long n = readInt(p);
+                for (long k=0; k<n; k++){
+                    p = nextLine();
+                    long i = readInt(p);
+                    if (i < 0 || i >= (long) n_vars)
+                        fail("unknown variable");
+                    inits[i] = readDouble(p);
+                }
+                break;
+            }
+            case 'r':
+                readBounds(con_lbs, con_ubs);
+                break;
+            case 'b':
+                readBounds(lbs, ubs);
+                break;
+            case 'd':
+            case 'k': {
+                // dual initial values and jacobian column counts
+                long n = readInt(p);
+                for (long k=0; k<n; k++)
+                    nextLine();
+                break;
+            }
+            case 'S': {
+                // suffixes
+                readInt(p);
+                long n = readInt(p);
+                for (long k=0; k<n; k++)
+                    nextLine();
+                break;
+            }
+            case 'F':
+                fail("imported functions are not supported");
+            default:
+                fail("unknown segment");
+        }
+    }
+    build();
+    TRACE_END;
+}
+
+const char* NLReader::nextLine(){
+    do {
+        if (not std::getline(*in, line)){
+            if (in->bad())
+                fail("read error");
+            return nullptr;
+        }
+        line_nr++;
+        auto comment = line.find('#');
+        if (comment != string::npos)
+            line.resize(comment);
+    } while (line.find_first_not_of(" \t\r") == string::npos);
+    const char* p = line.c_str();
+    while (*p == ' ' || *p == '\t')
+        p++;
+    return p;
+}
+
+void NLReader::fail(const string& msg)const {
+    throw MadOptError(".nl line " + std::to_string(line_nr) + ": " + msg);
+}
+
+long NLReader::readInt(const char*& p){
+    if (p == nullptr)
+        fail("unexpected end of file");
+    char* end;
+    long v = strtol(p, &end, 10);
+    if (end == p)
+        fail("integer expected");
+    p = end;
+    return v;
+}
+
+double NLReader::readDouble(const char*& p){
+    if (p == nullptr)
+        fail("unexpected end of file");
+    char* end;
+    double v = strtod(p, &end);
+    if (end == p)
+        fail("number expected");
+    p = end;
+    return v;
+}
+
+void NLReader::readHeader(){
+    const char* p = nextLine();
+    if (p == nullptr || *p != 'g'){
+        if (p != nullptr && *p == 'b')
+            fail("binary .nl files are not supported");
+        fail("not a .nl file");
+    }
+    p = nextLine();
+    n_vars = readInt(p);
+    n_cons = readInt(p);
+    n_objs = readInt(p);
+    p = nextLine();
+    p = nextLine();
+    if (readInt(p) != 0 || readInt(p) != 0)
+        fail("network constraints are not supported");
+    p = nextLine();
+    nl_cons = readInt(p);
+    nl_objs = readInt(p);
+    nl_both = readInt(p);
+    p = nextLine();
+    readInt(p);
+    if (readInt(p) != 0)
+        fail("imported functions are not supported");
+    p = nextLine();
+    n_binary = readInt(p);
+    n_integer = readInt(p);
+    nl_int_both = readInt(p);
+    nl_int_cons = readInt(p);
+    nl_int_objs = readInt(p);
+    for (int i=0; i<3; i++)
+        nextLine();
+    if (n_binary + n_integer > n_vars || nl_both > nl_cons
+            || nl_both > nl_objs || nl_cons + nl_objs - nl_both > n_vars)
+        fail("inconsistent header");
+}
+
+void NLReader::readExpr(Tape& tape){
+    // the expression is in prefix order, the operators are emitted once all
+    // their children are read
+    struct Node {
+        long code;
+        long left;
+        long nof_children;
+        //! start of the last child on the tape
+        size_t child_ops;
+        size_t child_data;
+    };
+    vector<Node> nodes;
+    auto push = [&](OPType type, Value v){
+        tape.ops.push_back(type);
+        tape.data.push_back(v);
+    };
+    auto constChild = [&](const Node& node){
+        return tape.ops.size() == node.child_ops + 1
+            && tape.ops.back() == OP_CONST;
+    };
+    do {
+        if (not nodes.empty()){
+            nodes.back().child_ops = tape.ops.size();
+            nodes.back().child_data = tape.data.size();
+        }
+        const char* p = nextLine();
+        if (p == nullptr)
+            fail("unexpected end of file");
+        char kind = *p++;
+        if (kind == 'n' || kind == 'l' || kind == 's'){
+            push(OP_CONST, Value(readDouble(p)));
+        } else if (kind == 'v'){
+            long i = readInt(p);
+            if (i >= 0 && i < (long) n_vars)
+                push(OP_VAR_IDX, Value((Idx) (i + var_offset)));
+            else if (i >= (long) n_vars && i < (long) (n_vars + defined.size())){
+                const Tape& d = defined[i - n_vars];
+                tape.ops.insert(tape.ops.end(), d.ops.begin(), d.ops.end());
+                tape.data.insert(tape.data.end(), d.data.begin(), d.data.end());
+            } else
+                fail("unknown variable");
+        } else if (kind == 'o'){
+            Node node = {readInt(p), 1, 0, 0, 0};
+            switch (node.code){
+                case NL_PLUS:
+                case NL_MINUS:
+                case NL_MULT:
+                case NL_DIV:
+                case NL_POW:
+                case NL_1POW:
+                    node.left = 2;
+                    break;
+                case NL_SUMLIST:
+                    p = nextLine();
+                    node.left = readInt(p);
+                    if (node.left < 1)
+                        fail("empty sum");
+                    break;
+                case NL_UMINUS:
+                case NL_2POW:
+                case NL_SQRT:
+                case NL_SIN:
+                case NL_COS:
+                case NL_TAN:
+                case NL_LOG:
+                case NL_LOG10:
+                case NL_EXP:
+                    break;
+                default:
+                    fail("operator o" + std::to_string(node.code)
+                            + " is not supported");
+            }
+            node.nof_children = node.left;
+            nodes.push_back(node);
+            continue;
+        } else
+            fail("expression expected");
+
+        // emit the operators that have all their children now
+        while (not nodes.empty() && --nodes.back().left == 0){
+            Node node = nodes.back();
+            nodes.pop_back();
+            switch (node.code){
+                case NL_PLUS:
+                    push(OP_ADD, Value((Idx) 2));
+                    break;
+                case NL_MINUS:
+                    push(OP_CONST, Value(-1.0));
+                    push(OP_MUL, Value((Idx) 2));
+                    push(OP_ADD, Value((Idx) 2));
+                    break;
+                case NL_MULT:
+                    push(OP_MUL, Value((Idx) 2));
+                    break;
+                case NL_DIV:
+                    if (constChild(node)){
+                        tape.data.back().d = 1/tape.data.back().d;
+                        push(OP_MUL, Value((Idx) 2));
+                    } else
+                        tape.ops.push_back(OP_DIV);
+                    break;
+                case NL_POW:
+                case NL_1POW: {
+                    if (not constChild(node))
+                        fail("only constant exponents are supported");
+                    double exponent = tape.data.back().d;
+                    tape.ops.pop_back();
+                    tape.data.pop_back();
+                    OPType type = powerType(exponent);
+                    if (type == OP_POW || type == OP_IPOW)
+                        push(type, Value(exponent));
+                    else
+                        tape.ops.push_back(type);
+                    break;
+                }
+                case NL_2POW:
+                    tape.ops.push_back(OP_SQR);
+                    break;
+                case NL_SQRT:
+                    tape.ops.push_back(OP_SQRT);
+                    break;
+                case NL_EXP:
+                    tape.ops.push_back(OP_EXP);
+                    break;
+                case NL_UMINUS:
+                    push(OP_CONST, Value(-1.0));
+                    push(OP_MUL, Value((Idx) 2));
+                    break;
+                case NL_SUMLIST:
+                    if (node.nof_children > 1)
+                        push(OP_ADD, Value((Idx) node.nof_children));
+                    break;
+                case NL_SIN:
+                    tape.ops.push_back(OP_SIN);
+                    break;
+                case NL_COS:
+                    tape.ops.push_back(OP_COS);
+                    break;
+                case NL_TAN:
+                    tape.ops.push_back(OP_TAN);
+                    break;
+                case NL_LOG:
+                    tape.ops.push_back(OP_LN);
+                    break;
+                case NL_LOG10:
+                    tape.ops.push_back(OP_LN);
+                    push(OP_CONST, Value(1/std::log(10.0)));
+                    push(OP_MUL, Value((Idx) 2));
+                    break;
+            }
+        }
+    } while (not nodes.empty());
+}
+
+void NLReader::readTerms(Terms& terms, const Idx& n){
+    terms.clear();
+    terms.reserve(n);
+    for (Idx k=0; k<n; k++){
+        const char* p = nextLine();
+        long i = readInt(p);
+        if (i < 0 || i >= (long) n_vars)
+            fail("unknown variable");
+        terms.emplace_back(i + var_offset, readDouble(p));
+    }
+}
+
+void NLReader::readBounds(vector<double>& lbs, vector<double>& ubs){
+    for (Idx i=0; i<lbs.size(); i++){
+        const char* p = nextLine();
+        switch (readInt(p)){
+            case 0:
+                lbs[i] = readDouble(p);
+                ubs[i] = readDouble(p);
+                break;
+            case 1:
+                ubs[i] = readDouble(p);
+                break;
+            case 2:
+                lbs[i] = readDouble(p);
+                break;
+            case 3:
+                break;
+            case 4:
+                lbs[i] = ubs[i] = readDouble(p);
+                break;
+            case 5:
+                fail("complementarity constraints are not supported");
+            default:
+                fail("unknown bound type");
+        }
+    }
+}
+
+void NLReader::addTerms(Tape& tape, const Terms& terms){
+    Idx parts = 1;
+    if (tape.ops.empty() || (tape.ops.size() == 1
+                && tape.ops[0] == OP_CONST && tape.data[0].d == 0)){
+        tape.ops.clear();
+        tape.data.clear();
+        parts = 0;
+    }
+    FOREACH(term, terms)
+        // variables with a nonlinear part are listed with 0
+        if (term.second == 0)
+            continue;
+        tape.ops.push_back(OP_VAR_IDX);
+        tape.data.push_back(Value((Idx) term.first));
+        if (term.second != 1){
+            tape.ops.push_back(OP_CONST);
+            tape.data.push_back(Value(term.second));
+            tape.ops.push_back(OP_MUL);
+            tape.data.push_back(Value((Idx) 2));
+        }
+        parts++;
+    }
+    if (parts == 0){
+        tape.ops.push_back(OP_CONST);
+        tape.data.push_back(Value(0.0));
+    } else if (parts > 1){
+        tape.ops.push_back(OP_ADD);
+        tape.data.push_back(Value(parts));
+    }
+}
+
+VarType NLReader::varType(const Idx& i)const {
+    if (i >= n_vars - n_integer)
+        return VarType::INTEGER;
+    if (i >= n_vars - n_integer - n_binary)
+        return VarType::BINARY;
+    // the integer variables of the nonlinear blocks are at their ends
+    if (i < nl_both)
+        return i >= nl_both - nl_int_both ? VarType::INTEGER : VarType::CONTINUOUS;
+    if (i < nl_cons)
+        return i >= nl_cons - nl_int_cons ? VarType::INTEGER : VarType::CONTINUOUS;
+    Idx nl_end = nl_cons + nl_objs - nl_both;
+    if (i < nl_end)
+        return i >= nl_end - nl_int_objs ? VarType::INTEGER : VarType::CONTINUOUS;
+    return VarType::CONTINUOUS;
+}
+
+void NLReader::build(){
+    TRACE_START;
+    for (Idx i=0; i<n_vars; i++){
+        double init = std::max(lbs[i], std::min(ubs[i], inits[i]));
+        switch (varType(i)){
+            case VarType::BINARY: {
+                // binaries may be fixed by their bounds
+                double lb = std::max(lbs[i], 0.0);
+                double ub = std::min(ubs[i], 1.0);
+                Var var = model.addBVar(std::max(lb, std::min(ub, init)), "");
+                var.lb(lb);
+                var.ub(ub);
+                break;
+            }
+            case VarType::INTEGER:
+                model.addIVar(lbs[i], ubs[i], init, "");
+                break;
+            default:
+                model.addCVar(lbs[i], ubs[i], init, "");
+        }
+    }
+    for (Idx i=0; i<n_cons; i++){
+        if (cons[i].ops.empty())
+            fail("constraint " + std::to_string(i) + " has no expression");
+        model.addConstr(con_lbs[i], std::move(cons[i]), con_ubs[i]);
+    }
+    cons.clear();
+    if (n_objs > 0 && not obj.ops.empty()){
+        if (maximize){
+            obj.ops.push_back(OP_CONST);
+            obj.data.push_back(Value(-1.0));
+            obj.ops.push_back(OP_MUL);
+            obj.data.push_back(Value((Idx) 2));
+        }
+        model.setObj(std::move(obj));
+    }
+    defined.clear();
+    TRACE_END;
+}
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_NL_READER_H
+#define MADOPT_NL_READER_H
+
+#include <istream>
+#include "common.hpp"
+#include "inner_constraint.hpp"
+
+namespace MadOpt {
+
+class Model;
+
+/*! \brief reads AMPL .nl files in text format into a Model
+ * \details the expressions are translated into tapes while they are read,
+ * no Expr is built. Supported are sums, differences, products, divisions,
+ * negation, powers with a constant exponent, sqrt, sin, cos, tan, log,
+ * log10 and defined variables. Only the first objective is read, a
+ * maximized one is negated. The variables are appended to the ones of the
+ * model.
+ */
+class NLReader {
+    public:
+        NLReader(Model& model);
+
+        //! reads the file path, throws a MadOptError if it is not supported
+        void read(const string& path);
+
+        //! \sa read(const string&)
+        void read(std::istream& in);
+
+    private:
+        typedef InnerConstraint::Tape Tape;
+        typedef vector<pair<Idx, double> > Terms;
+
+        Model& model;
+        std::istream* in;
+        string line;
+        Idx line_nr;
+        //! position of the first variable of the file in the model
+        Idx var_offset;
+
+        Idx n_vars;
+        Idx n_cons;
+        Idx n_objs;
+        Idx n_binary;
+        Idx n_integer;
+        //! integer variables at the end of the three nonlinear variable
+        //blocks, \sa readHeader()
+        Idx nl_both;
+        Idx nl_cons;
+        Idx nl_objs;
+        Idx nl_int_both;
+        Idx nl_int_cons;
+        Idx nl_int_objs;
+
+        vector<Tape> cons;
+        vector<double> con_lbs;
+        vector<double> con_ubs;
+        Tape obj;
+        bool maximize;
+        //! tapes of the defined variables, whose indices follow the ones of
+        //the variables
+        vector<Tape> defined;
+        vector<double> lbs;
+        vector<double> ubs;
+        vector<double> inits;
+
+        const char* nextLine();
+
+        [[noreturn]] void fail(const string& msg)const;
+
+        long readInt(const char*& p);
+
+        double readDouble(const char*& p);
+
+        void readHeader();
+
+        void readExpr(Tape& tape);
+
+        void readTerms(Terms& terms, const Idx& n);
+
+        void readBounds(vector<double>& lbs, vector<double>& ubs);
+
+        void addTerms(Tape& tape, const Terms& terms);
+
+        VarType varType(const Idx& i)const;
+
+        void build();
+};
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
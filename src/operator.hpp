@@ -16,6 +16,7 @@
 #ifndef MADOPT_OPERATOR_H
 #define MADOPT_OPERATOR_H
 
+#include <cmath>
 #include "common.hpp"
 #include "inner_var.hpp"
 #include "inner_param.hpp"
@@ -33,15 +34,50 @@
 #define OP_TAN 8
 #define OP_LOG2 9
 #define OP_LN 10
+#define OP_SQR 11
+//! integer power, computed by repeated multiplication
+#define OP_IPOW 12
+#define OP_INV 13
+#define OP_SQRT 14
+#define OP_EXP 15
+//! quotient of two operands, in an Expr the divisor comes first so that it
+//is on top of the stack on the tape
+#define OP_DIV 16
 
 #define OP_VAR_IDX 20
 #define OP_MUL_CONST 21
 #define OP_ADD_CONST 22
+#define OP_PARAM_SLOT 23
 
 namespace MadOpt {
 
 typedef char OPType;
 
+//! true for the operators that raise their operand to a constant power
+inline bool isPower(const OPType& type){
+    return type == OP_POW || type == OP_IPOW || type == OP_SQR
+        || type == OP_INV || type == OP_SQRT;
+}
+
+//! true if exponent can be evaluated by OP_IPOW
+inline bool isIntegral(const double& exponent){
+    return exponent == std::floor(exponent) && std::fabs(exponent) <= 1 << 30;
+}
+
+//! the operator for the power exponent, OP_POW if there is no specialised
+//one, OP_IPOW and OP_POW carry the exponent as data
+inline OPType powerType(const double& exponent){
+    if (exponent == 2)
+        return OP_SQR;
+    if (exponent == -1)
+        return OP_INV;
+    if (exponent == 0.5)
+        return OP_SQRT;
+    if (isIntegral(exponent))
+        return OP_IPOW;
+    return OP_POW;
+}
+
 class Operator{
     public:
 
@@ -94,6 +130,20 @@ class Operator{
             return value.d;
         }
 
+        //! exponent of a power operator, \sa isPower()
+        double getExponent()const {
+            switch(type){
+                case OP_SQR:
+                    return 2;
+                case OP_INV:
+                    return -1;
+                case OP_SQRT:
+                    return 0.5;
+                default:
+                    return getValue();
+            }
+        }
+
         InnerVar* getIVar()const { 
             checkVarPointer();
             return value.iVar; 
@@ -131,13 +181,16 @@ class Operator{
         Value value;
 
         void checkNone()const {
-            if (type != OP_SIN && type != OP_COS && type != OP_TAN && type != OP_LOG2 && type != OP_LN)
+            if (type != OP_SIN && type != OP_COS && type != OP_TAN && type != OP_LOG2 && type != OP_LN
+                    && type != OP_SQR && type != OP_INV && type != OP_SQRT
+                    && type != OP_EXP && type != OP_DIV)
                 throw MadOptError("wrong use of Expression type for none");
         }
 
         void checkDouble()const {
             if (type != OP_CONST 
                     && type != OP_POW
+                    && type != OP_IPOW
                     && type != OP_ADD_CONST
                     && type != OP_MUL_CONST)
                 throw MadOptError("wrong use of Expression type");
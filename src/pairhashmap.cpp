@@ -42,6 +42,14 @@ void PairHashMap::resize(const Idx& max_range){
     mapping.resize(2*max_range);
 }
 
+size_t PairHashMap::memory()const{
+    size_t bytes = MadOpt::memory(mapping);
+    FOREACH(bucket, mapping)
+        bytes += MadOpt::memory(bucket);
+    }
+    return bytes;
+}
+
 string PairHashMap::str()const{
     string res = "nofb=" + to_string(mapping.size()) + "::";
     Idx key = 0;
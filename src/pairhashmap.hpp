@@ -35,6 +35,9 @@ class PairHashMap {
 
         string str()const;
 
+        //! bytes allocated by the buckets
+        size_t memory()const;
+
     private:
         struct HashTuple {
             HashTuple(const HashPair& p, const Idx& value): p(p), value(value){}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MADOPT_PARAMSTACK
+#define MADOPT_PARAMSTACK
+
+#include <vector>
+#include "stack.hpp"
+#include "logger.hpp"
+#include "exceptions.hpp"
+
+namespace MadOpt {
+
+//! value only stack used to evaluate expressions that depend on parameters
+//and constants only
+class ParamStack: public Stack {
+    public:
+        ParamStack(): data_i(0){}
+
+        void doAdd(const Idx& nofelems){
+            ASSERT_LE(nofelems, size());
+            double sum = 0;
+            for (Idx i=0; i<nofelems; i++){
+                sum += stack.back();
+                stack.pop_back();
+            }
+            stack.push_back(sum);
+        }
+
+        void doMull(const Idx& nofelems){
+            ASSERT_LE(nofelems, size());
+            double prod = 1;
+            for (Idx i=0; i<nofelems; i++){
+                prod *= stack.back();
+                stack.pop_back();
+            }
+            stack.push_back(prod);
+        }
+
+        double& lastG(){
+            return stack.back();
+        }
+
+        void doUnaryOp(const double&, const double&){}
+
+        void emplace_back(const Idx&){
+            throw MadOptError("variable found in parameter expression");
+        }
+
+        void emplace_back(const double& value){
+            stack.push_back(value);
+        }
+
+        Idx size(){
+            return stack.size();
+        }
+
+        void clear(){
+            stack.clear();
+            data_i = 0;
+        }
+
+        Idx& getDataI(){
+            return data_i;
+        }
+
+    private:
+        std::vector<double> stack;
+        Idx data_i;
+};
+}
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "perf_counters.hpp"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace MadOpt {
+
+#ifdef __linux__
+static int openEvent(const uint64_t& config, const int& group,
+        const long& thread){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attr, thread, -1, group, 0);
+}
+#endif
+
+PerfCounters::PerfCounters(const long& thread): nof_counted(0){
+    for (int i=0; i<NOF_EVENTS; i++){
+        fds[i] = -1;
+        slots[i] = -1;
+    }
+#ifdef __linux__
+    const uint64_t configs[NOF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES};
+    int leader = -1;
+    for (int i=0; i<NOF_EVENTS; i++){
+        fds[i] = openEvent(configs[i], leader, thread);
+        if (fds[i] == -1)
+            continue;
+        if (leader == -1)
+            leader = fds[i];
+        slots[i] = nof_counted++;
+    }
+    if (leader != -1){
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters(){
+#ifdef __linux__
+    for (int i=NOF_EVENTS-1; i>=0; i--)
+        if (fds[i] != -1)
+            close(fds[i]);
+#endif
+}
+
+bool PerfCounters::available() const {
+    return nof_counted > 0;
+}
+
+bool PerfCounters::available(const Event& event) const {
+    return slots[event] != -1;
+}
+
+PerfCounts PerfCounters::read() const {
+    PerfCounts res;
+#ifdef __linux__
+    if (nof_counted == 0)
+        return res;
+    int leader = -1;
+    for (int i=0; i<NOF_EVENTS && leader == -1; i++)
+        leader = fds[i];
+    // nr, time_enabled, time_running, values
+    uint64_t data[3 + NOF_EVENTS];
+    ssize_t size = (3 + nof_counted)*sizeof(uint64_t);
+    if (::read(leader, data, size) != size || data[0] != (uint64_t)nof_counted)
+        return res;
+    double scale = data[2] == 0 ? 0 : double(data[1])/data[2];
+    uint64_t* counts[NOF_EVENTS] = {&res.cycles, &res.instructions,
+        &res.cache_misses, &res.branch_misses};
+    for (int i=0; i<NOF_EVENTS; i++)
+        if (slots[i] != -1)
+            *counts[i] = data[3 + slots[i]]*scale;
+#endif
+    return res;
+}
+
+PerfCounterSet::PerfCounterSet(const std::vector<long>& worker_ids):
+        owner_id(std::this_thread::get_id()){
+    if (not caller.available())
+        return;
+    for (const long& id: worker_ids){
+        // 0 would count the calling thread twice
+        if (id == 0)
+            continue;
+        workers.emplace_back(new PerfCounters(id));
+        if (not workers.back()->available())
+            workers.pop_back();
+    }
+}
+
+bool PerfCounterSet::available() const {
+    return caller.available();
+}
+
+bool PerfCounterSet::owner() const {
+    return std::this_thread::get_id() == owner_id;
+}
+
+PerfCounts PerfCounterSet::read() const {
+    PerfCounts res = caller.read();
+    for (auto& counters: workers)
+        res += counters->read();
+    return res;
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
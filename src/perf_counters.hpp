@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_PERF_COUNTERS_H
+#define MADOPT_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "common.hpp"
+
+namespace MadOpt {
+
+//! hardware event counts, the events that are not counted stay 0
+struct PerfCounts {
+    PerfCounts(): cycles(0), instructions(0), cache_misses(0),
+        branch_misses(0){}
+
+    uint64_t cycles;
+    uint64_t instructions;
+    //! last level cache misses
+    uint64_t cache_misses;
+    uint64_t branch_misses;
+
+    //! instructions per cycle
+    double ipc() const {
+        return cycles == 0 ? 0 : double(instructions)/cycles;
+    }
+
+    PerfCounts& operator+=(const PerfCounts& other){
+        cycles += other.cycles;
+        instructions += other.instructions;
+        cache_misses += other.cache_misses;
+        branch_misses += other.branch_misses;
+        return *this;
+    }
+
+    PerfCounts operator-(const PerfCounts& other) const {
+        PerfCounts res;
+        res.cycles = cycles - other.cycles;
+        res.instructions = instructions - other.instructions;
+        res.cache_misses = cache_misses - other.cache_misses;
+        res.branch_misses = branch_misses - other.branch_misses;
+        return res;
+    }
+};
+
+/*! \brief user space hardware counters of one thread, based on Linux
+ * perf_event_open
+ * \details the counters run from the construction on, read() costs one
+ * system call and may be called from any thread. If perf events are not supported, e.g. on other systems, in
+ * containers or with a restrictive kernel.perf_event_paranoid, available()
+ * is false and read() returns zeros. Events the processor does not support
+ * are left out.
+ */
+class PerfCounters {
+    public:
+        enum Event {CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES,
+            NOF_EVENTS};
+
+        //! counts the thread with the kernel id thread, 0 is the calling one
+        explicit PerfCounters(const long& thread=0);
+        ~PerfCounters();
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        //! true if at least one event is counted
+        bool available() const;
+
+        bool available(const Event& event) const;
+
+        //! counts since the construction, scaled up if the kernel had to
+        //multiplex the counters
+        PerfCounts read() const;
+
+    private:
+        //! file descriptors, the first open one leads the group
+        int fds[NOF_EVENTS];
+        //! position of the events in the group read, -1 if not counted
+        int slots[NOF_EVENTS];
+        int nof_counted;
+};
+
+/*! \brief hardware counters of the constructing thread and of worker
+ * threads that evaluate for it
+ * \details read() adds up the counts of all threads. Workers whose
+ * counters cannot be opened are left out.
+ */
+class PerfCounterSet {
+    public:
+        //! counts the calling thread and the threads with the kernel ids
+        //workers, \sa ThreadPool::threadIds()
+        explicit PerfCounterSet(const std::vector<long>& workers);
+
+        //! true if the counters of the constructing thread are available
+        bool available() const;
+
+        //! true if the calling thread constructed the set
+        bool owner() const;
+
+        PerfCounts read() const;
+
+    private:
+        std::thread::id owner_id;
+        PerfCounters caller;
+        std::vector<std::unique_ptr<PerfCounters>> workers;
+};
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
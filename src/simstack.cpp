@@ -29,13 +29,14 @@ void SimStack::doAdd(const Idx& nofelems){
     TRACE_END;
 }
 
-void SimStack::doMull(){
+void SimStack::doMull(const Idx& nofelems){
     TRACE_START;
-    ASSERT_LE(2, size());
-    hess_stack.setJac(jac_stack);
-    hess_stack.merge(2);
-    jac_stack.merge(2);
-    _size -= 1;
+    ASSERT_LE(2, nofelems);
+    ASSERT_LE(nofelems, size());
+    hess_stack.setJac(jac_stack, nofelems);
+    hess_stack.merge(nofelems);
+    jac_stack.merge(nofelems);
+    _size -= nofelems-1;
     TRACE(str());
     TRACE_END;
 }
@@ -135,6 +136,18 @@ const Idx& SimStack::max_hess_size()const{
     return hess_stack.max_size();
 }
 
+void SimStack::raiseMaxSizes(const SimStack& other){
+    raiseMaxSizes(other.max_g_size(), other.max_jac_size(),
+            other.max_hess_size());
+}
+
+void SimStack::raiseMaxSizes(const Idx& g, const Idx& jac, const Idx& hess){
+    if (g > _max_size)
+        _max_size = g;
+    jac_stack.raiseMaxSize(jac);
+    hess_stack.raiseMaxSize(hess);
+}
+
 void SimStack::setXSize(const Idx& size){
     TRACE_START;
     jac_stack.setXSize(size);
@@ -150,6 +163,10 @@ string SimStack::str(){
     return res;
 }
 
+size_t SimStack::memory()const{
+    return jac_stack.memory() + hess_stack.memory();
+}
+
 Idx& SimStack::getDataI(){
     return data_i;
 }
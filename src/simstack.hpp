@@ -29,7 +29,7 @@ class SimStack: public Stack {
 	SimStack(): dummy(0), _size(0), _max_size(0), data_i(0){}
 
         void doAdd(const Idx& nofelems);
-        void doMull(); 
+        void doMull(const Idx& nofelems);
         double& lastG();
         void doUnaryOp(const double& jac_value, const double& hess_value);
         void emplace_back(const Idx& id);
@@ -44,6 +44,12 @@ class SimStack: public Stack {
         const Idx& max_jac_size()const;
         const Idx& max_hess_size()const;
 
+        //! raise the max sizes to the ones of other
+        void raiseMaxSizes(const SimStack& other);
+
+        //! raise the max sizes to at least g, jac and hess
+        void raiseMaxSizes(const Idx& g, const Idx& jac, const Idx& hess);
+
         vector<Idx> getJacEntries();
         vector<PII> getHessEntries();
 
@@ -53,6 +59,9 @@ class SimStack: public Stack {
 
         string str();
 
+        //! bytes allocated by the jacobian and hessian stacks
+        size_t memory()const;
+
     private:
         double dummy;
         JacSimStack jac_stack;
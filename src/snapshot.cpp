@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "snapshot.hpp"
+#include "exceptions.hpp"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace MadOpt {
+
+static const char magic[8] = {'M', 'A', 'D', 'O', 'P', 'T', 'S', 'N'};
+
+//! incremented whenever the layout of the file changes
+static const uint32_t version = 3;
+
+static const size_t alignment = 8;
+
+static size_t padded(const size_t& bytes){
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+SnapshotWriter::SnapshotWriter(const string& path):
+    out(path, std::ios::binary | std::ios::trunc), path(path)
+{
+    if (not out)
+        throw MadOptError("cannot open snapshot " + path);
+    write(magic, sizeof(magic));
+    value<uint32_t>(version);
+    value<uint32_t>(sizeof(Idx));
+}
+
+void SnapshotWriter::write(const void* data, const size_t& bytes){
+    static const char zeros[alignment] = {0};
+    out.write(static_cast<const char*>(data), bytes);
+    out.write(zeros, padded(bytes) - bytes);
+}
+
+void SnapshotWriter::array(const vector<bool>& v){
+    vector<char> c(v.begin(), v.end());
+    array(c);
+}
+
+void SnapshotWriter::names(const std::unordered_map<Idx, string>& names){
+    vector<Idx> keys;
+    vector<Idx> lengths;
+    string chars;
+    FOREACH(it, names)
+        keys.push_back(it.first);
+        lengths.push_back(it.second.size());
+        chars += it.second;
+    }
+    array(keys);
+    array(lengths);
+    array(chars.data(), chars.size());
+}
+
+void SnapshotWriter::close(){
+    out.close();
+    if (not out)
+        throw MadOptError("writing snapshot " + path + " failed");
+}
+
+SnapshotReader::SnapshotReader(const string& path):
+    path(path), data(nullptr), size(0), pos(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw MadOptError("cannot open snapshot " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0){
+        ::close(fd);
+        throw MadOptError("cannot read snapshot " + path);
+    }
+    size = st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        throw MadOptError("cannot map snapshot " + path);
+    data = static_cast<const char*>(map);
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    if (size < sizeof(magic) || memcmp(read(sizeof(magic)), magic,
+                sizeof(magic)) != 0){
+        munmap(map, size);
+        throw MadOptError(path + " is not a madopt snapshot");
+    }
+    if (value<uint32_t>() != version || value<uint32_t>() != sizeof(Idx)){
+        munmap(map, size);
+        throw MadOptError("snapshot " + path + " has an incompatible version");
+    }
+}
+
+SnapshotReader::~SnapshotReader(){
+    munmap(const_cast<char*>(data), size);
+}
+
+const void* SnapshotReader::read(const size_t& bytes){
+    size_t next = pos + padded(bytes);
+    if (next > size || next < pos)
+        fail();
+    const void* result = data + pos;
+    pos = next;
+    return result;
+}
+
+void SnapshotReader::fail()const {
+    throw MadOptError("snapshot " + path + " is truncated");
+}
+
+void SnapshotReader::array(vector<bool>& v){
+    vector<char> c;
+    array(c);
+    v.assign(c.begin(), c.end());
+}
+
+void SnapshotReader::names(std::unordered_map<Idx, string>& names){
+    vector<Idx> keys;
+    vector<Idx> lengths;
+    array(keys);
+    array(lengths);
+    size_t n;
+    const char* chars = array<char>(n);
+    if (keys.size() != lengths.size())
+        fail();
+    names.clear();
+    size_t offset = 0;
+    for (Idx i=0; i<keys.size(); i++){
+        if (offset + lengths[i] > n)
+            fail();
+        names[keys[i]] = string(chars + offset, lengths[i]);
+        offset += lengths[i];
+    }
+}
+}
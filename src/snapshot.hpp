@@ -0,0 +1,116 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_SNAPSHOT_H
+#define MADOPT_SNAPSHOT_H
+
+#include <stdint.h>
+#include <fstream>
+#include <unordered_map>
+#include "common.hpp"
+
+namespace MadOpt {
+
+/*! \brief writes a snapshot file, \sa Model::save()
+ * \details the file starts with a header, followed by raw values and
+ * arrays, each padded to a multiple of 8 bytes, such that the reader can
+ * access them in the memory mapped file without copying them first
+ */
+class SnapshotWriter {
+    public:
+        //! opens path and writes the header, throws if it fails
+        SnapshotWriter(const string& path);
+
+        template<class T>
+        void value(const T& v){
+            write(&v, sizeof(T));
+        }
+
+        //! writes the size n followed by the values
+        template<class T>
+        void array(const T* data, const size_t& n){
+            value<uint64_t>(n);
+            write(data, n*sizeof(T));
+        }
+
+        template<class T>
+        void array(const vector<T>& v){
+            array(v.data(), v.size());
+        }
+
+        void array(const vector<bool>& v);
+
+        //! writes a sparse index to name map
+        void names(const std::unordered_map<Idx, string>& names);
+
+        //! flushes the file, throws if anything failed
+        void close();
+
+    private:
+        std::ofstream out;
+        string path;
+
+        void write(const void* data, const size_t& bytes);
+};
+
+//! reads a snapshot file written by a SnapshotWriter from a memory mapping
+class SnapshotReader {
+    public:
+        //! maps path and checks the header, throws if it fails
+        SnapshotReader(const string& path);
+
+        ~SnapshotReader();
+
+        SnapshotReader(const SnapshotReader&) = delete;
+
+        template<class T>
+        T value(){
+            return *static_cast<const T*>(read(sizeof(T)));
+        }
+
+        //! returns a pointer to the n values of the next array, valid while
+        //the reader exists
+        template<class T>
+        const T* array(size_t& n){
+            n = value<uint64_t>();
+            if (n > (size - pos) / sizeof(T))
+                fail();
+            return static_cast<const T*>(read(n*sizeof(T)));
+        }
+
+        template<class T>
+        void array(vector<T>& v){
+            size_t n;
+            const T* data = array<T>(n);
+            v.assign(data, data + n);
+        }
+
+        void array(vector<bool>& v);
+
+        void names(std::unordered_map<Idx, string>& names);
+
+    private:
+        string path;
+        const char* data;
+        size_t size;
+        size_t pos;
+
+        const void* read(const size_t& bytes);
+
+        [[noreturn]] void fail()const;
+};
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -85,6 +85,11 @@ class Solution{
         //! returns true if a solution is loaded
         bool hasSolution() const;
 
+        //! bytes allocated by the primal and dual values
+        size_t memory()const {
+            return MadOpt::memory(_x) + MadOpt::memory(_l);
+        }
+
     private:
         vector<double> _x;
         vector<double> _l;
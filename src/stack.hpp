@@ -25,7 +25,8 @@ class Stack {
         virtual ~Stack(){}
 
         virtual void doAdd(const Idx& nofelems)=0;
-        virtual void doMull()=0; 
+        //! product of the last nofelems elements, at least 2
+        virtual void doMull(const Idx& nofelems)=0;
         virtual double& lastG()=0;
         virtual void doUnaryOp(const double& jac_value, const double& hess_value)=0;
         virtual void emplace_back(const Idx& id)=0;
@@ -14,110 +14,114 @@
  * limitations under the License.
  */
 
-#include <stdlib.h>
-#include <algorithm>
-
 #include "threadpool.hpp"
 
-#include "inner_constraint.hpp"
-#include "adstack.hpp"
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace MadOpt {
 
-ThreadPool::ThreadPool(InnerConstraint* obj, 
-        InnerConstraint** cons,
-        size_t size,
-        ADStack& ref_stack):
-    constraints(cons),
-    obj(obj),
-    size(size),
-    stack(ref_stack),
-    finished_threads(size)
-    {
-        //unsigned int cores = std::thread::hardware_concurrency() - 1;
-        //const unsigned int one = 1;
-        //cores = std::max(one, cores);
-
-        const unsigned int cores = 1;
-
-        ldiv_t d = ldiv(size, cores+1);
-
-        unsigned int rest = d.rem;
-
-        for (size_t i=0; i<cores; i++){
-            unsigned int steps = d.quot;
-            if (rest > 0){
-                steps += 1;
-                rest--;
-            }
-
-            workers.emplace_back(&ThreadPool::thread_function,
-                    this, 
-                    std::ref(ref_stack), 
-                    start_pos,
-                    steps);
-            start_pos += steps;
-        }
-
-        count = d.quot + rest;
-    }
+ThreadPool::ThreadPool(size_t size): thread_ids(size > 0 ? size-1 : 0, 0),
+        next_task(0) {
+    for (size_t i=1; i<size; i++)
+        workers.emplace_back(&ThreadPool::thread_function, this, i);
+    std::unique_lock<std::mutex> _lock(lock);
+    main_wait.wait(_lock,
+            [this]{ return started_threads == thread_ids.size();});
+}
 
 ThreadPool::~ThreadPool(){
     {
         std::unique_lock<std::mutex> _lock(lock);
         stop = true;
-        finished_threads = 0;
     }
     thread_wait.notify_all();
     for (auto&& t : workers)
         t.join();
 }
 
-void ThreadPool::setEvals(const double* x){
-    xx = x;
-    finished_threads = 0;
-    thread_wait.notify_all();
+size_t ThreadPool::size()const{
+    return workers.size() + 1;
+}
+
+const std::vector<long>& ThreadPool::threadIds()const{
+    return thread_ids;
+}
 
-    obj->setEvals(x, &stack);
+void ThreadPool::runTasks(size_t n, Function f, void* d){
+    if (workers.empty() || n < 2){
+        for (size_t i=0; i<n; i++)
+            f(d, i, 0);
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> _lock(lock);
+        function = f;
+        data = d;
+        nof_tasks = n;
+        next_task = 0;
+        finished_threads = 0;
+        error = nullptr;
+        batch++;
+    }
+    thread_wait.notify_all();
 
-    for (size_t i=start_pos; i<count+start_pos; i++)
-        constraints[i]->setEvals(xx, &stack);
+    work(0);
 
     std::unique_lock<std::mutex> _lock(lock);
-    if (finished_threads < workers.size())
-        main_wait.wait(_lock, 
-                [this]{ return finished_threads == workers.size();});
-    ASSERT(finished_threads == workers.size());
+    main_wait.wait(_lock,
+            [this]{ return finished_threads == workers.size();});
+    if (error){
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
 }
 
-void ThreadPool::thread_function(ADStack& ref_stack, size_t start_pos, size_t count){
-    ADStack stack(ref_stack);
+void ThreadPool::work(size_t worker){
+    for (size_t task=next_task++; task<nof_tasks; task=next_task++){
+        try {
+            function(data, task, worker);
+        } catch (...) {
+            std::unique_lock<std::mutex> _lock(lock);
+            if (not error)
+                error = std::current_exception();
+        }
+    }
+}
 
+void ThreadPool::thread_function(size_t worker){
+    {
+        std::unique_lock<std::mutex> _lock(lock);
+#ifdef __linux__
+        thread_ids[worker-1] = syscall(SYS_gettid);
+#endif
+        started_threads++;
+        // workers is still filled by the constructor
+        if (started_threads == thread_ids.size())
+            main_wait.notify_one();
+    }
+    size_t done = 0;
     while(1){
         {
             std::unique_lock<std::mutex> _lock(lock);
-            thread_wait.wait(_lock, 
-                    [this]{ return finished_threads < workers.size();});
+            thread_wait.wait(_lock, [&]{ return stop || batch != done;});
+            if (stop)
+                break;
+            done = batch;
         }
 
-        if (stop)
-            break;
-
-        ASSERT(finished_threads < workers.size(), finished_threads, size);
-        ASSERT(xx != nullptr, finished_threads, size, workers.size());
-
-        for (size_t i=start_pos; i<start_pos+count; i++)
-            constraints[i]->setEvals(xx, &stack);
+        work(worker);
 
         { 
             std::unique_lock<std::mutex> _lock(lock);
             finished_threads++;
-            if (finished_threads == workers.size()){
+            if (finished_threads == workers.size())
                 main_wait.notify_one();
-            }
         }
     }
 }
 
-
 }
@@ -20,49 +20,89 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <exception>
 #include <vector>
 
 namespace MadOpt {
 
-class InnerConstraint;
-class ADStack;
-
+/*! \brief persistent threads that run batches of tasks
+ * \details the thread calling run() works on the batch as well, so a pool of
+ * size n starts n-1 threads. Running a batch does not allocate.
+ */
 class ThreadPool {
     public:
-        ThreadPool(InnerConstraint*, InnerConstraint**, size_t, ADStack&);
+        explicit ThreadPool(size_t size);
         
         ~ThreadPool();
 
-        void setEvals(const double* x);
+        ThreadPool(const ThreadPool&) = delete;
+
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        //! number of threads working on a batch, the calling one included
+        size_t size()const;
+
+        //! kernel ids of the started threads, worker i is threadIds()[i-1],
+        //0 on systems other than Linux
+        const std::vector<long>& threadIds()const;
+
+        /*! \brief calls f(task, worker) for every task in 0 to nof_tasks-1
+         * and returns once all are finished
+         * \details worker is below size() and unique among the concurrent
+         * calls, the calling thread is worker 0. The first exception thrown
+         * by f is rethrown.
+         */
+        template<class F>
+        void run(size_t nof_tasks, F& f){
+            runTasks(nof_tasks, &call<F>, &f);
+        }
 
     private:
+        typedef void (*Function)(void*, size_t, size_t);
+
+        template<class F>
+        static void call(void* f, size_t task, size_t worker){
+            (*static_cast<F*>(f))(task, worker);
+        }
+
         std::vector<std::thread> workers;
 
+        //! \sa threadIds()
+        std::vector<long> thread_ids;
+
+        //! number of threads that have set their id
+        size_t started_threads = 0;
+
         std::mutex lock;
 
         std::condition_variable thread_wait;
 
         std::condition_variable main_wait;
 
-        InnerConstraint** constraints;
+        //! the current batch
+        Function function = nullptr;
 
-        InnerConstraint* obj;
+        void* data = nullptr;
 
-        size_t size;
+        size_t nof_tasks = 0;
 
-        const double* xx = nullptr;
+        std::atomic<size_t> next_task;
 
-        bool stop = false;
+        //! incremented for every batch
+        size_t batch = 0;
+
+        size_t finished_threads = 0;
 
-        ADStack& stack;
+        bool stop = false;
 
-        size_t finished_threads;
+        std::exception_ptr error;
 
-        size_t count;
+        void runTasks(size_t nof_tasks, Function function, void* data);
 
-        size_t start_pos;
+        void work(size_t worker);
 
-        void thread_function(ADStack&, size_t, size_t);
+        void thread_function(size_t worker);
 };
 
 }
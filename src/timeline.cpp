@@ -0,0 +1,159 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "timeline.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MadOpt {
+
+struct TimelineSpan {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+//! ring buffer of one thread, only the owning thread writes
+struct TimelineBuffer {
+    TimelineBuffer(const size_t& capacity, const size_t& tid):
+        spans(capacity), count(0), tid(tid){}
+
+    std::vector<TimelineSpan> spans;
+    //! number of spans recorded, the latest is spans[(count-1) % capacity]
+    std::atomic<uint64_t> count;
+    size_t tid;
+};
+
+/*! \brief buffers of all threads
+ * \details a buffer is shared by the registry and its thread, it outlives
+ * its thread until the next start() and the previous recording until its
+ * thread records again
+ */
+struct TimelineRegistry {
+    TimelineRegistry(): capacity(0){}
+
+    std::mutex lock;
+    std::vector<std::shared_ptr<TimelineBuffer>> buffers;
+    size_t capacity;
+};
+
+static TimelineRegistry& registry(){
+    static TimelineRegistry r;
+    return r;
+}
+
+static thread_local std::shared_ptr<TimelineBuffer> local_buffer;
+//! Timeline::recording() of local_buffer
+static thread_local size_t local_recording = 0;
+
+void Timeline::start(size_t spans_per_thread){
+    if (spans_per_thread == 0)
+        throw MadOptError("timeline needs space for at least one span");
+    auto& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    active().store(false);
+    r.buffers.clear();
+    r.capacity = spans_per_thread;
+    epoch().store(clock(), std::memory_order_release);
+    // invalidates the spans of running scopes and the buffers cached by
+    // threads
+    recordings().fetch_add(1, std::memory_order_release);
+    active().store(true);
+}
+
+void Timeline::stop(){
+    active().store(false);
+}
+
+void Timeline::record(const char* name, const uint64_t& begin,
+        const uint64_t& end, const size_t& recording){
+    if (recording != Timeline::recording())
+        return;
+    auto& r = registry();
+    if (local_buffer == nullptr || local_recording != recording){
+        std::lock_guard<std::mutex> guard(r.lock);
+        // start() ran since the check above
+        if (recording != Timeline::recording())
+            return;
+        r.buffers.emplace_back(new TimelineBuffer(r.capacity,
+                    r.buffers.size()));
+        local_buffer = r.buffers.back();
+        local_recording = recording;
+    }
+    TimelineBuffer& buffer = *local_buffer;
+    uint64_t count = buffer.count.load(std::memory_order_relaxed);
+    buffer.spans[count % buffer.spans.size()] = {name, begin, end};
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+size_t Timeline::size(){
+    auto& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    size_t n = 0;
+    for (auto& buffer: r.buffers)
+        n += std::min<uint64_t>(buffer->count.load(std::memory_order_acquire),
+                buffer->spans.size());
+    return n;
+}
+
+static std::string escaped(const char* name){
+    std::string res;
+    for (const char* c=name; *c!='\0'; c++){
+        if (*c == '"' || *c == '\\')
+            res += '\\';
+        res += *c;
+    }
+    return res;
+}
+
+void Timeline::write(const std::string& path){
+    std::ofstream out(path);
+    if (not out)
+        throw MadOptError("cannot write timeline to " + path);
+    auto& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    bool first = true;
+    for (auto& buffer: r.buffers){
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", "
+            << "\"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+            << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+        first = false;
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        const uint64_t capacity = buffer->spans.size();
+        for (uint64_t i=(count > capacity ? count - capacity : 0); i<count; i++){
+            const TimelineSpan& span = buffer->spans[i % capacity];
+            // microseconds
+            out << ",\n{\"name\": \"" << escaped(span.name)
+                << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+                << ", \"ts\": " << span.begin/1000 << "." << std::setfill('0')
+                << std::setw(3) << span.begin%1000
+                << ", \"dur\": " << (span.end - span.begin)/1000 << "."
+                << std::setw(3) << (span.end - span.begin)%1000 << "}";
+        }
+    }
+    out << "\n]}\n";
+    if (not out)
+        throw MadOptError("cannot write timeline to " + path);
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
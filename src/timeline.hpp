@@ -0,0 +1,129 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_TIMELINE_H
+#define MADOPT_TIMELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace MadOpt {
+
+/*! \brief records spans of the model build, the symbolic analysis and the
+ * solver callbacks as Chrome/Perfetto trace events
+ * \details every thread writes into a ring buffer of its own, recording is
+ * lock free and only the first span of a thread takes a lock to register its
+ * buffer. The oldest spans of a thread are overwritten once its buffer is
+ * full. Spans are recorded by TIMELINE_SCOPE, and by TRACE_START if
+ * compiled with ENABLE_TIMELINE_TRACING, see logger.hpp. While disabled a
+ * span costs one atomic load. start() may run while other threads record,
+ * their spans that began in the previous recording are dropped.
+ */
+class Timeline {
+    public:
+        //! drops all spans and starts recording with up to
+        //spans_per_thread spans per thread
+        static void start(size_t spans_per_thread=1<<16);
+
+        //! stops recording, the spans are kept until the next start()
+        static void stop();
+
+        static bool enabled(){
+            return active().load(std::memory_order_relaxed);
+        }
+
+        /*! \brief writes the spans as trace event JSON, to be opened with
+         * chrome://tracing or ui.perfetto.dev
+         * \details should not be called while spans are recorded
+         */
+        static void write(const std::string& path);
+
+        //! number of spans kept in the buffers
+        static size_t size();
+
+        //! nanoseconds since start()
+        static uint64_t now(){
+            return clock() - epoch().load(std::memory_order_acquire);
+        }
+
+        //! number of start() calls, identifies the current recording
+        static size_t recording(){
+            return recordings().load(std::memory_order_acquire);
+        }
+
+        //! adds a span of the calling thread that began in the given
+        //recording(), spans of a previous recording are dropped. name has
+        //to outlive the timeline, e.g. a string literal or __func__.
+        static void record(const char* name, const uint64_t& begin,
+                const uint64_t& end, const size_t& recording);
+
+    private:
+        static std::atomic<bool>& active(){
+            static std::atomic<bool> a(false);
+            return a;
+        }
+
+        //! steady clock in nanoseconds
+        static uint64_t clock(){
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        //! clock() at the last start()
+        static std::atomic<uint64_t>& epoch(){
+            static std::atomic<uint64_t> e(0);
+            return e;
+        }
+
+        //! \sa recording(), incremented after the epoch is set
+        static std::atomic<size_t>& recordings(){
+            static std::atomic<size_t> r(0);
+            return r;
+        }
+};
+
+//! records its lifetime as span if the timeline is enabled
+class TimelineScope {
+    public:
+        TimelineScope(const char* name): name(name),
+                active(Timeline::enabled()),
+                recording(active ? Timeline::recording() : 0),
+                begin(active ? Timeline::now() : 0){}
+
+        ~TimelineScope(){
+            if (active)
+                Timeline::record(name, begin, Timeline::now(), recording);
+        }
+
+    private:
+        const char* name;
+        bool active;
+        //! read before begin, so begin is relative to its epoch or later
+        size_t recording;
+        uint64_t begin;
+};
+
+#define MADOPT_TIMELINE_CONCAT2(a, b) a##b
+#define MADOPT_TIMELINE_CONCAT(a, b) MADOPT_TIMELINE_CONCAT2(a, b)
+
+//! records the rest of the enclosing scope as span named name
+#define TIMELINE_SCOPE(name) MadOpt::TimelineScope \
+    MADOPT_TIMELINE_CONCAT(timeline_scope_, __LINE__)(name)
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cxxtest/TestSuite.h>
+#include "testmodel.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+/*! \file
+ * the evaluation callbacks must not allocate once their buffers are sized,
+ * this runner replaces operator new to count the allocations
+ */
+
+// atomic for the worker threads of eval_threads
+static std::atomic<size_t> nof_allocations(0);
+static std::atomic<bool> count_allocations(false);
+
+void* operator new(size_t size){
+    if (count_allocations)
+        nof_allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+class AllocTest: public CxxTest::TestSuite {
+    public:
+
+        const Idx N = 200;
+
+        //! a model with each kind of operator, hoisted parameters and
+        //conflicts
+        void build(TestModel& m, vector<Var>& x, Param& p){
+            x.resize(N);
+            for (Idx i=0; i<N; i++)
+                x[i] = m.addVar(-1, 1, 0.3, "");
+            p = m.addParam(2, "p");
+            for (Idx i=0; i<N-2; i++)
+                m.addConstr(0, pow(x[i], 2)*sin(x[i+1]) + p*x[i+2]*x[i]
+                        + ln(x[i+1] + 3) + cos(x[i]*x[i+1]*x[i+2]), 1);
+            m.addConstrs(N-1, [&](const Idx& i, double& lb, double& ub){
+                    lb = -1;
+                    ub = 1;
+                    return x[i]*x[i+1] - x[i]*x[i] + pow(x[i+1], 3);
+                });
+            Expr obj;
+            for (Idx i=0; i<N; i++)
+                obj += pow(x[i] - 1, 2);
+            m.setObj(obj);
+        }
+
+        /*! \brief runs all callbacks at warmup points, then counts the
+         * allocations of runs further points
+         * \details the points change one variable after the other
+         */
+        size_t allocations(TestModel& m, const Idx& warmup, const Idx& runs){
+            vector<double> x(m.nx(), 0.3), g(m.ng()), grad(m.nx());
+            vector<double> jac(m.getNNZ_Jac()), hess(m.getNNZ_Hess());
+            vector<double> lambda(m.ng(), 1);
+            double f;
+            for (Idx k=0; k<warmup+runs; k++){
+                count_allocations = k >= warmup;
+                x[k % m.nx()] += 1e-3;
+                m.setEvals(x.data());
+                m.eval_f(x.data(), true, f);
+                m.eval_grad_f(x.data(), false, grad.data());
+                m.eval_g(x.data(), false, g.data());
+                m.eval_jac_g(x.data(), false, jac.data());
+                m.eval_h(x.data(), false, hess.data(), 1, lambda.data());
+                m.eval_h(x.data(), true, hess.data(), 0.5, lambda.data());
+            }
+            count_allocations = false;
+            size_t res = nof_allocations;
+            nof_allocations = 0;
+            return res;
+        }
+
+        void testCounting(){
+            count_allocations = true;
+            vector<double>* v = new vector<double>(10);
+            count_allocations = false;
+            delete v;
+            TS_ASSERT_EQUALS(nof_allocations, 2);
+            nof_allocations = 0;
+        }
+
+        void testEvals(){
+            TestModel m;
+            vector<Var> x;
+            Param p;
+            build(m, x, p);
+            TS_ASSERT_EQUALS(allocations(m, 1, 20), 0);
+        }
+
+        void testIncrementalEvals(){
+            TestModel m;
+            vector<Var> x;
+            Param p;
+            build(m, x, p);
+            m.setIncrementalEvals(true);
+            TS_ASSERT_EQUALS(allocations(m, 1, 20), 0);
+        }
+
+        void testHessSkipping(){
+            TestModel m;
+            vector<Var> x;
+            Param p;
+            build(m, x, p);
+            m.hess_skipping = true;
+            m.hess_skip_threshold = 0.5;
+            TS_ASSERT_EQUALS(allocations(m, 1, 20), 0);
+        }
+
+        void testSplitSums(){
+            TestModel m;
+            m.eval_threads = 4;
+            m.split_terms = 16;
+            vector<Var> x;
+            Param p;
+            build(m, x, p);
+            TS_ASSERT_EQUALS(allocations(m, 1, 20), 0);
+        }
+
+        void testStatsAndProfile(){
+            TestModel m;
+            vector<Var> x;
+            Param p;
+            build(m, x, p);
+            m.collect_stats = true;
+            m.profileConstraints(2);
+            TS_ASSERT_EQUALS(allocations(m, 1, 20), 0);
+        }
+
+        void testFullEvalCache(){
+            TestModel m;
+            vector<Var> x;
+            Param p;
+            build(m, x, p);
+            // room for 4 points, each point evicts the oldest one
+            m.setEvalCacheBudget(1);
+            allocations(m, 1, 0);
+            m.setEvalCacheBudget(4*m.getEvalCache().entryBytes());
+            TS_ASSERT_EQUALS(allocations(m, 4, 20), 0);
+            TS_ASSERT_EQUALS(m.getEvalCache().size(), 4);
+
+            // the entries are kept for the points after a parameter change
+            p.value(3);
+            TS_ASSERT_EQUALS(allocations(m, 0, 20), 0);
+        }
+};
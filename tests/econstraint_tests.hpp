@@ -103,6 +103,34 @@ class EConstraintTest: public CxxTest::TestSuite {
             Tes(x*a, {2}, 8, {0}, {4});
         }
 
+        void testParamExpr(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Param x = m.addParam(3, "x");
+            Param y = m.addParam(12, "y");
+            Tes(pow(x*y, 0.5)*a + sin(x*2) + a*y, {2}, 6*2 + std::sin(6) + 2*12,
+                    {0}, {6 + 12});
+            Tes(pow(x*y, 0.5)*a*a, {2}, 6*2*2, {0}, {6*2*2},
+                    {PII(0,0)}, {6*2});
+
+            HessPosMap hess_pos_map;
+            auto& simstack = m.getSimStack();
+            simstack.setXSize(1);
+            InnerConstraint constraint(pow(x+y, 2)*a + x*y, 0, 0,
+                    hess_pos_map, simstack);
+            auto& cstack = m.getCStack();
+            cstack.resize(simstack);
+            vector<double> xx = {2};
+            cstack.setX(xx.data());
+            constraint.setEvals(cstack);
+            TS_ASSERT_DELTA(constraint.getG(), 15*15*2 + 36, 1e-9);
+            TS_ASSERT_DELTA(constraint.getJac()[0], 15*15, 1e-9);
+            x.value(1);
+            constraint.setEvals(cstack);
+            TS_ASSERT_DELTA(constraint.getG(), 13*13*2 + 12, 1e-9);
+            TS_ASSERT_DELTA(constraint.getJac()[0], 13*13, 1e-9);
+        }
+
         void testADD(){
             TestModel m;
             Var a = m.addVar("a");
@@ -167,6 +195,32 @@ class EConstraintTest: public CxxTest::TestSuite {
             Tes(pow(2*a, 3), {3}, pow(6,3), {0}, {3*2*pow(2*3,2)}, {PII(0,0)}, {3*2*2*2*pow(2*3,1)});
         }
 
+        void testSpecialisedOps(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            Param p = m.addParam(2, "p");
+            const double e2 = std::exp(2);
+            Tes(pow(a+1, 2), {3}, 16, {0}, {8}, {PII(0,0)}, {2});
+            Tes(pow(a, 5), {2}, 32, {0}, {80}, {PII(0,0)}, {160});
+            Tes(pow(a, -2), {2}, 0.25, {0}, {-0.25}, {PII(0,0)}, {0.375});
+            Tes(pow(a, -1), {2}, 0.5, {0}, {-0.25}, {PII(0,0)}, {0.25});
+            Tes(sqrt(a), {4}, 2, {0}, {0.25}, {PII(0,0)}, {-0.03125});
+            Tes(exp(2*a), {1}, e2, {0}, {2*e2}, {PII(0,0)}, {4*e2});
+            Tes(a/b, {3, 2}, 1.5, {0, 1}, {0.5, -0.75},
+                    {PII(0,1), PII(1,1)}, {-0.25, 0.75});
+            Tes(a/(a+b), {1, 3}, 0.25, {0, 1}, {3./16, -1./16},
+                    {PII(0,0), PII(0,1), PII(1,1)}, {-6./64, -2./64, 2./64});
+            // nested powers collapsing to an exponent of one
+            Tes(pow(sqrt(a), 2), {0}, 0, {0}, {1});
+            Tes(pow(pow(a, 2), 0.5), {0}, 0, {0}, {1});
+            Tes(pow(pow(a, -1), -1), {0}, 0, {0}, {1});
+            Tes(pow(pow(a, 2), 0.5)*b, {0, 3}, 0, {0, 1}, {3, 0},
+                    {PII(0,1)}, {1});
+            // parameter expressions are evaluated by the ParamStack
+            Tes(a*exp(p) + a/p, {3}, 3*e2 + 1.5, {0}, {e2 + 0.5});
+        }
+
         void testMulti(){
             TestModel m;
             Var a = m.addVar("a");
@@ -309,6 +363,20 @@ class EConstraintTest: public CxxTest::TestSuite {
             Tes(x*x*x, {1}, 1, {0}, {3}, {PII(0,0)}, {6});
         }
 
+        void testNaryMUL(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            Var c = m.addVar("c");
+            // zero factor, repeated variable
+            Tes(a*b*c*a, {2, 0, 5}, 0, {0, 1, 2}, {0, 20, 0},
+                    {PII(0,0), PII(0,1), PII(0,2), PII(1,2)}, {0, 20, 0, 4});
+            // factors sharing variables
+            Tes((a+b)*(b+c)*(c+a)*2, {1, 2, 3}, 120, {0, 1, 2}, {70, 64, 54},
+                    {PII(0,0), PII(0,1), PII(0,2), PII(1,1), PII(1,2), PII(2,2)},
+                    {20, 24, 24, 16, 24, 12});
+        }
+
 	void testIssue25Bug(){
 	    TestModel m;
 	    auto x = m.addVar(0.999, 1.001, 1.0, "x");
@@ -226,19 +226,33 @@ class ExprTest: public CxxTest::TestSuite {
            TestModel m;
             Var a = m.addVar("a");
             Var b = m.addVar("b");
-            Tes(pow(a,5), "a^5", OP_POW);
-            Tes(pow(a+b,5), "(a+b)^5", OP_POW);
+            Tes(pow(a,5), "a^5", OP_IPOW);
+            Tes(pow(a+b,5), "(a+b)^5", OP_IPOW);
             Tes(pow(a,1), "a", OP_VAR_POINTER);
             Tes(pow(a,0), "1", OP_CONST, true);
-            Tes(pow(a,2), "a^2", OP_POW);
-            Tes(pow(pow(a, 2), 3), "a^6", OP_POW);
+            Tes(pow(a,2), "a^2", OP_SQR);
+            Tes(pow(pow(a, 2), 3), "a^6", OP_IPOW);
+            Tes(pow(a,-1), "a^-1", OP_INV);
+            Tes(pow(a,-3), "a^-3", OP_IPOW);
+            Tes(pow(a,2.5), "a^2.5", OP_POW);
+            Tes(sqrt(a), "a^0.5", OP_SQRT);
+            Tes(pow(sqrt(a), 4), "a^2", OP_SQR);
         }
 
         void testDiv(){
            TestModel m;
             Var a = m.addVar("a");
             Var b = m.addVar("b");
-            Tes(a/b, "a*(b^-1)", OP_MUL);
+            Tes(a/b, "a/b", OP_DIV);
+            Tes((a+b)/(2*b), "(a+b)/(2*b)", OP_DIV);
+            Tes(a/2, "a*0.5", OP_MUL);
+        }
+
+        void testEXP(){
+           TestModel m;
+            Var a = m.addVar("a");
+            Tes(exp(a), "exp(a)", OP_EXP);
+            Tes(2*exp(a), "2*exp(a)", OP_MUL);
         }
 
         void testSIN(){
@@ -187,4 +187,22 @@ public:
             m.solve();
             TS_ASSERT(m.hasSolution());
        }
+
+        void testStats(){
+            IpoptModel m;
+            Var a = m.addVar(0, 1, 0.5, "a");
+            Var b = m.addVar(0, 1, 0.5, "b");
+            m.addConstr(1, a*a + b, 3);
+            m.setObj(a*b);
+            m.solve();
+            TS_ASSERT_EQUALS(m.stats()[ModelStats::EVAL_F].calls, 0);
+
+            m.collect_stats = true;
+            m.solve();
+            const ModelStats& stats = m.stats();
+            TS_ASSERT(stats[ModelStats::EVAL_F].calls > 0);
+            TS_ASSERT(stats[ModelStats::EVAL_JAC_G].calls > 0);
+            TS_ASSERT(stats[ModelStats::EVAL_H].calls > 0);
+            TS_ASSERT(stats.callbackTime() <= stats.solve_time);
+        }
 };
@@ -15,6 +15,13 @@
  */
 #include <cxxtest/TestSuite.h>
 #include "testmodel.hpp"
+#include <cstdio>
+#include <sstream>
+#include "nl_reader.hpp"
+#include "timeline.hpp"
+#include <fstream>
+#include <iterator>
+#include <thread>
 using namespace MadOpt;
 
 class ModelTest: public CxxTest::TestSuite {
@@ -208,4 +215,856 @@ public:
             TS_ASSERT_EQUALS(iRow, iRow_res);
             TS_ASSERT_EQUALS(iRow, iRow_res);
         }
+
+        void testHessSkipping(){
+            TestModel m;
+            Idx N = 10;
+            buildChain(m, N);
+
+            vector<double> xval(N);
+            for (Idx i=0; i<N; i++)
+                xval[i] = -0.1*i;
+            vector<double> lambda(m.ng());
+            for (Idx i=0; i<m.ng(); i++)
+                lambda[i] = (i%2 == 0) ? 0 : 0.5*i;
+
+            Idx nhess = m.getNNZ_Hess();
+            vector<double> full(nhess);
+            vector<double> skipped(nhess);
+            m.eval_h(xval.data(), true, full.data(), 1, lambda.data());
+
+            m.hess_skipping = true;
+            m.resetHessCounters();
+            m.eval_h(xval.data(), true, skipped.data(), 1, lambda.data());
+            for (Idx i=0; i<nhess; i++)
+                TS_ASSERT_DELTA(full[i], skipped[i], 1e-12);
+            TS_ASSERT_EQUALS(m.nofSkippedHessRows(), (N-2)/2);
+            TS_ASSERT_EQUALS(m.nofEvaluatedHessRows(), (N-2)/2 + 1);
+
+            m.eval_h(xval.data(), false, skipped.data(), 0, lambda.data());
+            TS_ASSERT_EQUALS(m.nofSkippedHessRows(), (N-2)/2*2 + 1);
+
+            vector<double> jac(m.getNNZ_Jac());
+            m.eval_jac_g(xval.data(), true, jac.data());
+            m.hess_skip_threshold = 100;
+            m.eval_h(xval.data(), false, skipped.data(), 1, lambda.data());
+            TS_ASSERT_EQUALS(m.nofSkippedHessRows(), (N-2)/2*2 + 1 + N-2);
+        }
+
+        void testEvalOrder(){
+            TestModel m, ref;
+            Idx N = 10;
+            buildChain(m, N);
+            buildChain(ref, N);
+
+            vector<double> lambda(m.ng(), 0.7);
+            vector<double> x1(N, -0.2);
+            vector<double> x2(N);
+            for (Idx i=0; i<N; i++)
+                x2[i] = -0.1*i;
+
+            double f;
+            m.eval_f(x1.data(), true, f);
+            compareEvals(m, ref, x2.data(), lambda.data());
+        }
+
+        void testEvalCache(){
+            TestModel m, ref;
+            Idx N = 6;
+            buildChain(m, N);
+            buildChain(ref, N);
+            m.setEvalCacheBudget(1 << 20);
+
+            vector<double> lambda(m.ng(), 0.7);
+            vector<double> x1(N, -0.2);
+            vector<double> x2(N, -0.4);
+            for (auto* x: {&x1, &x2, &x1})
+                compareEvals(m, ref, x->data(), lambda.data());
+
+            TS_ASSERT_EQUALS(m.getEvalCache().nofHits(), 1);
+            TS_ASSERT_EQUALS(m.getEvalCache().nofMisses(), 2);
+            TS_ASSERT_EQUALS(m.getEvalCache().size(), 2);
+
+            m.setEvalCacheBudget(m.getEvalCache().memory()/2);
+            TS_ASSERT_EQUALS(m.getEvalCache().size(), 1);
+            vector<double> g(m.ng());
+            m.eval_g(x2.data(), true, g.data());
+            TS_ASSERT_EQUALS(m.getEvalCache().nofMisses(), 3);
+        }
+
+        void testParamChanges(){
+            TestModel m, other;
+            Idx N = 6;
+            vector<Var> x = buildChain(m, N);
+            Param p = m.addParam(2, "p");
+            Param q = other.addParam(1, "q");
+            m.addConstr(p*x[0] + sin(p)*x[1], 1);
+            m.setEvalCacheBudget(1 << 20);
+
+            vector<double> x1(N, -0.2), g(m.ng()), g_p(m.ng());
+            m.eval_g(x1.data(), true, g.data());
+            // other models do not outdate the evaluations
+            q.value(3);
+            m.eval_g(x1.data(), true, g.data());
+            TS_ASSERT_EQUALS(m.getEvalCache().nofHits(), 1);
+            TS_ASSERT_EQUALS(m.getEvalCache().size(), 1);
+
+            p.value(3);
+            m.eval_g(x1.data(), true, g_p.data());
+            TS_ASSERT_EQUALS(m.getEvalCache().size(), 1);
+            TS_ASSERT_DELTA(g_p[N-2], -0.6 - 0.2*std::sin(3), 1e-12);
+
+            TS_ASSERT_THROWS(m.addConstr(q*x[0], 1), MadOptError);
+            TS_ASSERT_THROWS(m.addConstrs({0}, {x[1] + q}, {1}), MadOptError);
+        }
+
+        void testIncrementalEvals(){
+            TestModel m, ref;
+            Idx N = 6;
+            buildChain(m, N);
+            buildChain(ref, N);
+            m.setIncrementalEvals(true);
+
+            vector<double> lambda(m.ng(), 0.7);
+            vector<double> x1(N, -0.2);
+            vector<double> x2(x1);
+            x2[N-1] = -0.4;
+            for (auto* x: {&x1, &x2, &x1})
+                compareEvals(m, ref, x->data(), lambda.data());
+
+            m.setIncrementalEvals(false);
+            compareEvals(m, ref, x2.data(), lambda.data());
+        }
+
+        void testAddConstrs(){
+            TestModel m, ref;
+            Idx N = 5;
+            vector<Var> x(N), x_ref(N);
+            for (Idx i=0; i<N; i++){
+                x[i] = m.addVar(-1, 1, 0.5, "x" + std::to_string(i));
+                x_ref[i] = ref.addVar(-1, 1, 0.5, "x" + std::to_string(i));
+            }
+            m.setObj(x[0]*x[1]);
+            ref.setObj(x_ref[0]*x_ref[1]);
+            m.addConstr(0, x[0]*x[0], 1);
+            ref.addConstr(0, x_ref[0]*x_ref[0], 1);
+            for (Idx i=0; i<N-1; i++)
+                ref.addConstr(-1, sin(x_ref[i])*x_ref[i+1], i);
+
+            auto cons = m.addConstrs(N-1, [&](const Idx& i, double& lb, double& ub){
+                    lb = -1;
+                    ub = i;
+                    return sin(x[i])*x[i+1];
+                });
+            TS_ASSERT_EQUALS(cons.size(), N-1);
+            TS_ASSERT_EQUALS(cons[2].ub(), 2);
+
+            vector<double> xx(N, 0.3);
+            vector<double> lambda(m.ng(), 1);
+            compareEvals(m, ref, xx.data(), lambda.data());
+
+            Idx njac = m.getNNZ_Jac();
+            m.addConstrs({0}, {x[0] + x[1]}, {1});
+            TS_ASSERT_EQUALS(m.getNNZ_Jac(), njac + 2);
+            TS_ASSERT_THROWS(m.addConstrs({0}, {x_ref[0]}, {1}), MadOptError);
+            TS_ASSERT_THROWS(m.addConstrs({2}, {x[0]}, {1}), MadOptError);
+        }
+
+        void testParallelSymbolic(){
+            TestModel m, ref;
+            m.symbolic_threads = 4;
+            ref.symbolic_threads = 1;
+            Idx N = 2000;
+            for (auto* model: {&m, &ref}){
+                vector<Var> x(N);
+                for (Idx i=0; i<N; i++)
+                    x[i] = model->addVar(-1, 1, 0.5, "x" + std::to_string(i));
+                model->addConstrs(N-2, [&](const Idx& i, double& lb, double& ub){
+                        lb = 0;
+                        ub = 1;
+                        return pow(x[(7*i)%N], 2)*x[i+1] + sin(x[i+2]*x[i]);
+                    });
+            }
+            vector<double> xx(N, 0.3);
+            vector<double> lambda(m.ng(), 1);
+            compareEvals(m, ref, xx.data(), lambda.data());
+        }
+
+        void testParallelEval(){
+            TestModel m, ref;
+            m.eval_threads = 4;
+            m.split_terms = 8;
+            Idx N = 200;
+            for (auto* model: {&m, &ref}){
+                vector<Var> x(N);
+                for (Idx i=0; i<N; i++)
+                    x[i] = model->addVar(-1, 1, 0.5, "x" + std::to_string(i));
+                Expr obj(0);
+                Expr sum(0);
+                for (Idx i=0; i<N; i++){
+                    obj += x[i]*x[(3*i)%N] + pow(x[i], 3) + (double) i;
+                    sum += sin(x[i]*x[(i+1)%N]);
+                }
+                model->setObj(obj);
+                model->addConstr(-1, sum, 1);
+                model->addConstr(0, x[0]*x[1], 1);
+            }
+            vector<double> xx(N);
+            for (Idx i=0; i<N; i++)
+                xx[i] = std::cos(i);
+            vector<double> lambda = {0.5, 2};
+            for (Idx pass=0; pass<3; pass++){
+                if (pass == 2)
+                    m.eval_threads = 1;
+                xx[pass] += 0.25;
+                compareEvals(m, ref, xx.data(), lambda.data(), 1e-9);
+            }
+
+            // 200 terms, at least split_terms per chunk
+            vector<Var> x;
+            for (Idx i=0; i<N; i++)
+                x.push_back(m.addVar(-1, 1, 0.5, "y"));
+            Expr sum(0);
+            for (Idx i=0; i<N; i++)
+                sum += x[i]*x[(i+1)%N];
+            SimStack stack;
+            stack.setXSize(m.nx());
+            vector<std::pair<Idx, Idx>> splits = {{4, 8}, {4, 80}, {4, 150},
+                {1, 8}};
+            vector<Idx> chunks;
+            FOREACH(split, splits)
+                InnerConstraint con(sum, 0, 0);
+                con.analyze(stack, split.first, split.second);
+                chunks.push_back(con.nofChunks());
+            }
+            TS_ASSERT_EQUALS(chunks, vector<Idx>({4, 2, 0, 0}));
+        }
+
+        void testVarPool(){
+            TestModel m;
+            Var a = m.addVar(-1, 1, 0, "a");
+            Var b = m.addVar(-1, 1, 0, "");
+            m.keep_names = false;
+            vector<Var> x;
+            for (Idx i=0; i<5000; i++)
+                x.push_back(m.addVar(0, 2, 1, "x"));
+            Param p = m.addParam(3, "p");
+            TS_ASSERT_EQUALS(a.name(), "a");
+            TS_ASSERT_EQUALS(b.name(), "v1");
+            TS_ASSERT_EQUALS(x[7].name(), "v9");
+            TS_ASSERT_EQUALS(p.name(), "p0");
+            TS_ASSERT_EQUALS(a.getPos(), 0);
+            TS_ASSERT_EQUALS(x[4999].getPos(), 5001);
+
+            x[3].ub(1.5);
+            x[3].fixed(true);
+            TS_ASSERT_EQUALS(x[3].ub(), 1);
+            x[3].fixed(false);
+            TS_ASSERT_EQUALS(x[3].ub(), 1.5);
+            TS_ASSERT_EQUALS(x[2].ub(), 2);
+
+            TS_ASSERT_THROWS(m.addVar(1, 0, 0, "c"), MadOptError);
+            TS_ASSERT_THROWS(x[0].lb(3), MadOptError);
+            TS_ASSERT_EQUALS(m.nx(), 5002);
+            Var c = m.addVar(0, 1, 0, "c");
+            TS_ASSERT_EQUALS(c.getPos(), 5002);
+        }
+
+        void testSaveLoad(){
+            const char* path = "model_tests.snapshot";
+            TestModel m, loaded;
+            Idx N = 6;
+            vector<Var> x(N);
+            for (Idx i=0; i<N; i++)
+                x[i] = m.addVar(-1, 1, 0.5, i == 2 ? "x2" : "");
+            x[4].fixed(true);
+            Param p = m.addParam(2, "p");
+            m.setObj(x[0]*x[1] + p*p*x[2]);
+            m.addConstr(0, pow(x[0], 2) + sin(x[1]), 1);
+            m.addConstrs(N-1, [&](const Idx& i, double& lb, double& ub){
+                    lb = -1;
+                    ub = i;
+                    return (p + 1)*x[i]*x[i+1] + cos(x[i]);
+                });
+            m.save(path);
+            loaded.load(path);
+            std::remove(path);
+
+            TS_ASSERT_EQUALS(loaded.nx(), m.nx());
+            TS_ASSERT_EQUALS(loaded.ng(), m.ng());
+            TS_ASSERT_EQUALS(loaded.np(), 1);
+            TS_ASSERT_EQUALS(loaded.getVar(2).name(), "x2");
+            TS_ASSERT_EQUALS(loaded.getVar(3).name(), "v3");
+            TS_ASSERT(loaded.getVar(4).fixed());
+            TS_ASSERT_EQUALS(loaded.getParam(0).name(), "p");
+
+            vector<double> lb(m.ng()), ub(m.ng()), lb_l(m.ng()), ub_l(m.ng());
+            vector<double> xl(N), xu(N);
+            m.getBounds(xl.data(), xu.data(), lb.data(), ub.data());
+            loaded.getBounds(xl.data(), xu.data(), lb_l.data(), ub_l.data());
+            TS_ASSERT_EQUALS(lb, lb_l);
+            TS_ASSERT_EQUALS(ub, ub_l);
+            TS_ASSERT_EQUALS(xu[4], 0.5);
+
+            vector<double> xx = {0.1, -0.2, 0.3, 0.4, 0.5, -0.6};
+            vector<double> lambda(m.ng(), 1);
+            compareEvals(m, loaded, xx.data(), lambda.data());
+            p.value(-3);
+            loaded.getParam(0).value(-3);
+            compareEvals(m, loaded, xx.data(), lambda.data());
+
+            TS_ASSERT_THROWS(loaded.load(path), MadOptError);
+            TestModel empty;
+            TS_ASSERT_THROWS(empty.load(path), MadOptError);
+        }
+
+        void testSaveLoadLinear(){
+            const char* path = "model_tests_linear.snapshot";
+            // linear models have no hessian entries, the last one has no
+            // objective
+            for (Idx k=0; k<3; k++){
+                TestModel m, loaded;
+                Var x = m.addVar(-1, 1, 0.5, "x");
+                Var y = m.addVar(-1, 1, 0.5, "y");
+                if (k == 0)
+                    m.setObj(x + 2*y);
+                if (k == 1)
+                    m.setObj(x);
+                if (k != 1)
+                    m.addConstr(0, x + y, 1);
+                m.save(path);
+                loaded.load(path);
+                std::remove(path);
+                TS_ASSERT_EQUALS(loaded.getNNZ_Hess(), 0);
+                vector<double> xx = {0.3, -0.7}, lambda(m.ng(), 1);
+                compareEvals(m, loaded, xx.data(), lambda.data());
+            }
+        }
+
+        void testLoadCorrupt(){
+            const char* path = "model_tests_corrupt.snapshot";
+            TestModel m;
+            vector<Var> x = buildChain(m, 5);
+            Param p = m.addParam(2, "p");
+            m.addConstr(0, p*x[0]*x[1] + pow(x[2], 3)/x[3] + sqrt(p), 1);
+            m.save(path);
+            std::ifstream file(path, std::ios::binary);
+            string data((std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+            file.close();
+
+            // each byte flipped once, the loaded models are evaluated within
+            // their buffers, which the sanitizer builds check
+            Idx loaded = 0;
+            for (size_t pos=0; pos<data.size(); pos++){
+                string corrupt = data;
+                corrupt[pos] ^= 0x5a;
+                std::ofstream(path, std::ios::binary) << corrupt;
+                TestModel model;
+                try {
+                    model.load(path);
+                } catch (const MadOptError&){
+                    TS_ASSERT_EQUALS(model.nx(), 0);
+                    TS_ASSERT_EQUALS(model.np(), 0);
+                    TS_ASSERT_EQUALS(model.ng(), 0);
+                    continue;
+                }
+                loaded++;
+                vector<double> xx(model.nx(), -0.3), g(model.ng());
+                vector<double> grad(model.nx()), lambda(model.ng(), 1);
+                vector<double> jac(model.getNNZ_Jac());
+                vector<double> hess(model.getNNZ_Hess());
+                double f;
+                model.eval_f(xx.data(), true, f);
+                model.eval_grad_f(xx.data(), false, grad.data());
+                model.eval_g(xx.data(), false, g.data());
+                model.eval_jac_g(xx.data(), false, jac.data());
+                model.eval_h(xx.data(), false, hess.data(), 1, lambda.data());
+            }
+            TS_ASSERT(loaded > 0);
+
+            TestModel retry;
+            std::ofstream(path, std::ios::binary) << data.substr(0, data.size()/2);
+            TS_ASSERT_THROWS(retry.load(path), MadOptError);
+            TS_ASSERT_EQUALS(retry.nx(), 0);
+            std::ofstream(path, std::ios::binary) << data;
+            retry.load(path);
+            std::remove(path);
+            vector<double> xx(m.nx(), -0.3), lambda(m.ng(), 1);
+            compareEvals(m, retry, xx.data(), lambda.data());
+        }
+
+        void testMapConstraintData(){
+            TestModel m, ref;
+            Idx N = 3000;
+            vector<Var> x(N), x_ref(N);
+            for (Idx i=0; i<N; i++){
+                x[i] = m.addVar(-1, 1, 0.5, "");
+                x_ref[i] = ref.addVar(-1, 1, 0.5, "");
+            }
+            auto build = [&](TestModel& model, vector<Var>& v, Idx begin,
+                    Idx end){
+                model.addConstrs(end - begin, [&](const Idx& i, double& lb, double& ub){
+                        lb = 0;
+                        ub = 1;
+                        Idx k = begin + i;
+                        return pow(v[k], 2)*v[k+1] + sin(v[k+2]*v[k]);
+                    });
+            };
+            build(ref, x_ref, 0, N-2);
+            ref.addConstr(0, x_ref[0]*x_ref[1], 1);
+            build(m, x, 0, 10);
+            m.finalizeConstraints();
+            m.mapConstraintData(".");
+            TS_ASSERT(m.getArena().fileBacked());
+            TS_ASSERT(not ref.getArena().fileBacked());
+            // grows the mapping
+            build(m, x, 10, N-2);
+            m.addConstr(0, x[0]*x[1], 1);
+
+            vector<double> xx(N);
+            for (Idx i=0; i<N; i++)
+                xx[i] = sin(i);
+            vector<double> lambda(m.ng(), 0.5);
+            compareEvals(m, ref, xx.data(), lambda.data());
+        }
+
+        void testReadNL(){
+            // min (x0 - 1)^2 + x1/x2
+            // s.t. sin(x0) + 2*x1 <= 3
+            //      1 <= d + log(x2) <= 10, d = x0*x1 + 0.5*x2
+            std::istringstream nl(
+                "g3 1 1 0\t# problem test\n"
+                " 3 2 1 1 0\t# vars, constraints, objectives, ranges, eqns\n"
+                " 2 1\t# nonlinear constraints, objectives\n"
+                " 0 0\t# network constraints: nonlinear, linear\n"
+                " 3 3 3\t# nonlinear vars in constraints, objectives, both\n"
+                " 0 0 0 1\t# linear network variables; functions; arith, flags\n"
+                " 0 0 0 0 0\t# discrete variables: binary, integer, nonlinear (b,c,o)\n"
+                " 5 3\t# nonzeros in Jacobian, gradients\n"
+                " 0 0\t# max name lengths: constraints, variables\n"
+                " 1 0 0 0 0\t# common exprs: b,c,o,c1,o1\n"
+                "V3 1 0\n2 0.5\no2\nv0\nv1\n"
+                "C0\no41\nv0\n"
+                "C1\no54\n2\nv3\no43\nv2\n"
+                "O0 0\no0\no5\no0\nv0\nn-1\nn2\no3\nv1\nv2\n"
+                "x3\n0 0.5\n1 1\n2 2\n"
+                "r\n1 3\n0 1 10\n"
+                "b\n0 -5 5\n2 -1\n3\n"
+                "k2\n2\n4\n"
+                "J0 2\n0 0\n1 2\n"
+                "J1 3\n0 0\n1 0\n2 0\n"
+                "G0 3\n0 0\n1 0\n2 0\n");
+            TestModel m, ref;
+            NLReader(m).read(nl);
+
+            Var x0 = ref.addVar(-5, 5, 0.5, "");
+            Var x1 = ref.addVar(-1, INF, 1, "");
+            Var x2 = ref.addVar(2, "");
+            ref.setObj(pow(x0 - 1, 2) + x1/x2);
+            ref.addConstr(sin(x0) + 2*x1, 3);
+            ref.addConstr(1, x0*x1 + 0.5*x2 + ln(x2), 10);
+
+            TS_ASSERT_EQUALS(m.nx(), 3);
+            TS_ASSERT_EQUALS(m.ng(), 2);
+            vector<double> xl(3), xu(3), gl(2), gu(2), xi(3);
+            m.getBounds(xl.data(), xu.data(), gl.data(), gu.data());
+            m.getInits(xi.data());
+            TS_ASSERT_EQUALS(xl, vector<double>({-5, -1, -INF}));
+            TS_ASSERT_EQUALS(xu, vector<double>({5, INF, INF}));
+            TS_ASSERT_EQUALS(gl, vector<double>({-INF, 1}));
+            TS_ASSERT_EQUALS(gu, vector<double>({3, 10}));
+            TS_ASSERT_EQUALS(xi, vector<double>({0.5, 1, 2}));
+
+            vector<double> x = {0.3, -0.7, 1.9};
+            vector<double> lambda = {0.5, -2};
+            for (auto* model: {&m, &ref}){
+                double f;
+                vector<double> g(2);
+                model->eval_f(x.data(), true, f);
+                model->eval_g(x.data(), false, g.data());
+                TS_ASSERT_DELTA(f, pow(0.3 - 1, 2) + -0.7/1.9, 1e-12);
+                TS_ASSERT_DELTA(g[0], std::sin(0.3) - 1.4, 1e-12);
+                TS_ASSERT_DELTA(g[1], -0.21 + 0.95 + std::log(1.9), 1e-12);
+            }
+
+            // dense jacobian and lower triangle of the hessian
+            auto dense = [&](TestModel& model, vector<double>& jac,
+                    vector<double>& hess){
+                Idx njac = model.getNNZ_Jac();
+                Idx nhess = model.getNNZ_Hess();
+                vector<int> rows(njac), cols(njac);
+                vector<double> values(njac);
+                model.getNZ_Jac(rows.data(), cols.data());
+                model.eval_jac_g(x.data(), true, values.data());
+                jac.assign(6, 0);
+                for (Idx i=0; i<njac; i++)
+                    jac[3*rows[i] + cols[i]] += values[i];
+                rows.resize(nhess);
+                cols.resize(nhess);
+                values.assign(nhess, 0);
+                model.getNZ_Hess(rows.data(), cols.data());
+                model.eval_h(x.data(), false, values.data(), 1, lambda.data());
+                hess.assign(9, 0);
+                for (Idx i=0; i<nhess; i++)
+                    hess[3*std::max(rows[i], cols[i]) + std::min(rows[i], cols[i])]
+                        += values[i];
+            };
+            vector<double> jac, hess, jac_ref, hess_ref;
+            dense(m, jac, hess);
+            dense(ref, jac_ref, hess_ref);
+            for (Idx i=0; i<jac.size(); i++)
+                TS_ASSERT_DELTA(jac[i], jac_ref[i], 1e-12);
+            for (Idx i=0; i<hess.size(); i++)
+                TS_ASSERT_DELTA(hess[i], hess_ref[i], 1e-12);
+
+            // binaries keep their bounds, x0 is fixed to one
+            std::istringstream fixed(
+                "g3 1 1 0\n 2 0 1 0 0\n 0 0\n 0 0\n 0 0 0\n 0 0 0 1\n"
+                " 2 0 0 0 0\n 0 2\n 0 0\n 0 0 0 0 0\n"
+                "O0 0\nn0\n"
+                "b\n4 1\n0 0 1\n"
+                "G0 2\n0 1\n1 1\n");
+            TestModel bin;
+            NLReader(bin).read(fixed);
+            TS_ASSERT_EQUALS(bin.nx(), 2);
+            xl.resize(2);
+            xu.resize(2);
+            xi.resize(2);
+            bin.getBounds(xl.data(), xu.data(), nullptr, nullptr);
+            bin.getInits(xi.data());
+            TS_ASSERT_EQUALS(xl, vector<double>({1, 0}));
+            TS_ASSERT_EQUALS(xu, vector<double>({1, 1}));
+            TS_ASSERT_EQUALS(xi, vector<double>({1, 0}));
+
+            // x0^1 + x1^0 are evaluated at zero by OP_IPOW
+            std::istringstream powers(
+                "g3 1 1 0\n 2 0 1 0 0\n 0 1\n 0 0\n 0 2 0\n 0 0 0 1\n"
+                " 0 0 0 0 0\n 0 2\n 0 0\n 0 0 0 0 0\n"
+                "O0 0\no0\no5\nv0\nn1\no5\nv1\nn0\n"
+                "G0 2\n0 0\n1 0\n");
+            TestModel pm;
+            NLReader(pm).read(powers);
+            vector<double> zero(2, 0), grad(2);
+            double f;
+            pm.eval_f(zero.data(), true, f);
+            pm.eval_grad_f(zero.data(), false, grad.data());
+            TS_ASSERT_EQUALS(f, 1);
+            TS_ASSERT_EQUALS(grad, vector<double>({1, 0}));
+            hess.assign(pm.getNNZ_Hess(), 1);
+            pm.eval_h(zero.data(), false, hess.data(), 1, nullptr);
+            for (auto& v: hess)
+                TS_ASSERT_EQUALS(v, 0);
+
+            TestModel other;
+            std::istringstream binary("b3 1 1 0\n");
+            TS_ASSERT_THROWS(NLReader(other).read(binary), MadOptError);
+            std::istringstream unsupported(
+                "g3 1 1 0\n 1 1 0 0 0\n 1 0\n 0 0\n 1 0 0\n 0 0 0 1\n"
+                " 0 0 0 0 0\n 1 0\n 0 0\n 0 0 0 0 0\n"
+                "C0\no45\nv0\n");
+            TS_ASSERT_THROWS(NLReader(other).read(unsupported), MadOptError);
+        }
+
+        void testStats(){
+            TestModel m;
+            TS_ASSERT(m.callbackStats(ModelStats::EVAL_F) == nullptr);
+            m.collect_stats = true;
+            for (bool new_x: {true, false, false, true}){
+                CallbackTimer timer(m.callbackStats(ModelStats::EVAL_G), new_x);
+            }
+            const CallbackStats& g = m.stats()[ModelStats::EVAL_G];
+            TS_ASSERT_EQUALS(g.calls, 4);
+            TS_ASSERT_EQUALS(g.new_x, 2);
+            TS_ASSERT_EQUALS(g.hitRate(), 0.5);
+            TS_ASSERT(g.max_time <= g.total_time);
+            TS_ASSERT_EQUALS(m.stats().callbackTime(), g.total_time);
+            TS_ASSERT_EQUALS(m.stats()[ModelStats::EVAL_H].calls, 0);
+            m.resetStats();
+            TS_ASSERT_EQUALS(m.stats()[ModelStats::EVAL_G].calls, 0);
+        }
+
+        void testPhaseStats(){
+            TestModel m;
+            Idx N = 100;
+            vector<Var> x(N);
+            for (Idx i=0; i<N; i++)
+                x[i] = m.addVar(-1, 1, 0.5, "");
+            for (Idx i=0; i<N-1; i++)
+                m.addConstr(0, sin(x[i])*x[i+1], 1);
+            m.setObj(x[0]*x[1]);
+
+            vector<double> xx(N, 0.3), g(m.ng()), jac(m.getNNZ_Jac());
+            vector<double> hess(m.getNNZ_Hess()), lambda(m.ng(), 1);
+            m.eval_g(xx.data(), true, g.data());
+            TS_ASSERT_EQUALS(m.stats().phases[ModelStats::FORWARD].calls, 0);
+
+            m.collect_stats = true;
+            for (Idx k=0; k<3; k++){
+                xx[0] += 0.1;
+                m.setEvals(xx.data());
+                m.eval_g(xx.data(), false, g.data());
+                m.eval_jac_g(xx.data(), false, jac.data());
+                m.eval_h(xx.data(), false, hess.data(), 1, lambda.data());
+            }
+            const ModelStats& stats = m.stats();
+            TS_ASSERT_EQUALS(stats.phases[ModelStats::FORWARD].calls, 6);
+            TS_ASSERT_EQUALS(stats.phases[ModelStats::JACOBIAN].calls, 3);
+            TS_ASSERT_EQUALS(stats.phases[ModelStats::HESSIAN].calls, 3);
+            TS_ASSERT(stats.phases[ModelStats::HESSIAN].total_time > 0);
+            TS_ASSERT_EQUALS(stats.hardware_counters, PerfCounters().available());
+            const PerfCounts& counts = stats.phases[ModelStats::HESSIAN].counters;
+            // timing only without perf events
+            TS_ASSERT(stats.hardware_counters || counts.cycles
+                    + counts.instructions + counts.cache_misses
+                    + counts.branch_misses == 0);
+            TS_ASSERT(not stats.hardware_counters
+                    || counts.cycles + counts.instructions > 0);
+            TS_ASSERT_EQUALS(ModelStats::name(ModelStats::JACOBIAN),
+                    string("jacobian"));
+
+            // the counters follow the evaluating thread and the workers
+            m.resetStats();
+            m.eval_threads = 2;
+            std::thread other([&](){
+                    m.eval_h(xx.data(), true, hess.data(), 1, lambda.data());
+                });
+            other.join();
+            m.eval_h(xx.data(), true, hess.data(), 1, lambda.data());
+            const PhaseStats& hessian = m.stats().phases[ModelStats::HESSIAN];
+            TS_ASSERT_EQUALS(hessian.calls, 2);
+            TS_ASSERT_EQUALS(m.stats().hardware_counters,
+                    PerfCounters().available());
+            TS_ASSERT(not m.stats().hardware_counters
+                    || hessian.counters.instructions > 0);
+        }
+
+        void testConstraintProfile(){
+            TestModel m;
+            Idx N = 10;
+            vector<Var> x(N);
+            for (Idx i=0; i<N; i++)
+                x[i] = m.addVar(-1.5, 0, -0.5, "x" + std::to_string(i));
+            Param p = m.addParam(2, "p");
+            for (Idx i=0; i<N-2; i++)
+                m.addEqConstr((pow(x[i+1], 2) + 1.5*x[i+1] - p)*cos(x[i+2]) - x[i], 0);
+            Expr heavy(0);
+            for (Idx k=0; k<50; k++)
+                for (Idx i=0; i<N; i++)
+                    heavy += sin(x[i]*x[(i+k)%N]);
+            m.addConstr(heavy, 1);
+            m.setObj(x[0]);
+
+            vector<double> xval(N, -0.5), g(m.ng()), jac(m.getNNZ_Jac());
+            vector<double> hess(m.getNNZ_Hess()), lambda(m.ng(), 1);
+            m.profileConstraints(1);
+            for (Idx k=0; k<3; k++){
+                xval[0] -= 0.1;
+                m.eval_g(xval.data(), true, g.data());
+                m.eval_jac_g(xval.data(), false, jac.data());
+                m.eval_h(xval.data(), false, hess.data(), 1, lambda.data());
+            }
+            auto top = m.constraintProfile(2);
+            TS_ASSERT_EQUALS(top.size(), 2);
+            TS_ASSERT_EQUALS(top[0].row, N-2);
+            TS_ASSERT(not top[0].objective);
+            TS_ASSERT(top[0].time >= top[1].time);
+            TS_ASSERT_EQUALS(top[0].samples, 3*3);
+            TS_ASSERT_EQUALS(top[0].nnz_jac, N);
+            TS_ASSERT(top[0].tape_size > 50*N);
+            TS_ASSERT(top[0].nnz_hess > 0);
+            TS_ASSERT_EQUALS(top[0].expr.size(), 83);
+            TS_ASSERT_EQUALS(top[0].expr.substr(0, 11), "sin(x0*x0)+");
+
+            auto all = m.constraintProfile(N);
+            TS_ASSERT_EQUALS(all.size(), N);
+            Idx objectives = 0;
+            FOREACH(row, all)
+                if (row.objective)
+                    objectives++;
+                else if (row.row == 0)
+                    TS_ASSERT_EQUALS(row.expr,
+                        ((pow(x[1], 2) + 1.5*x[1] - p)*cos(x[2]) - x[0]).toString());
+            }
+            TS_ASSERT_EQUALS(objectives, 1);
+
+            m.resetConstraintProfile();
+            TS_ASSERT_EQUALS(m.constraintProfile(N).size(), 0);
+            m.profileConstraints(0);
+            m.eval_g(xval.data(), true, g.data());
+            TS_ASSERT_EQUALS(m.constraintProfile(N).size(), 0);
+        }
+
+        void testMemoryReport(){
+            TestModel m;
+            Idx N = 1000;
+            MemoryReport empty = m.memoryReport();
+            TS_ASSERT_EQUALS(empty.tapes, 0);
+
+            buildChain(m, N);
+            m.finalizeConstraints();
+
+            MemoryReport r = m.memoryReport();
+            TS_ASSERT(r.vars >= empty.vars + N*(3*sizeof(double) + sizeof(VarType)));
+            TS_ASSERT(r.constraints >= (N-2)*sizeof(InnerConstraint));
+            TS_ASSERT_EQUALS(r.tapes, m.getArena().tapeMemory());
+            TS_ASSERT(r.jac_hess >= m.getArena().mapMemory());
+            TS_ASSERT(r.jac_hess >= m.getNNZ_Jac()*sizeof(Idx));
+            TS_ASSERT(r.hash_maps >= m.getNNZ_Hess()*sizeof(HessPosMap::value_type));
+            TS_ASSERT(r.stacks > 0);
+            TS_ASSERT_EQUALS(r.file_backed, 0);
+            TS_ASSERT_EQUALS(r.total(), r.vars + r.params + r.constraints
+                    + r.tapes + r.jac_hess + r.stacks + r.hash_maps
+                    + r.eval_cache + r.solution);
+            TS_ASSERT(r.process_rss > r.total());
+
+            m.setEvalCacheBudget(1 << 20);
+            vector<double> xval(N, -0.5), g(m.ng());
+            m.eval_g(xval.data(), true, g.data());
+            TS_ASSERT(m.memoryReport().eval_cache > r.eval_cache);
+
+            m.mapConstraintData(".");
+            r = m.memoryReport();
+            TS_ASSERT_EQUALS(r.file_backed, r.tapes + m.getArena().mapMemory());
+        }
+
+        void testAnalyze(){
+            TestModel m;
+            Var x = m.addVar(-1, 1, 0, "x");
+            Var y = m.addVar(-1, 1, 0, "y");
+            Var z = m.addVar(-1, 1, 0, "z");
+            Param p = m.addParam(2, "p");
+            m.addConstr(x + 2*y, 1);
+            m.addConstr(x*y, 1);
+            m.addConstr(y*z, 1);
+            m.addConstr(pow(x, 2)*sin(y), 1);
+            m.addConstr(pow(z, 3) + p*x, 1);
+            m.setObj(pow(x, 2) + z);
+
+            ModelAnalysis a = m.analyze();
+            TS_ASSERT_EQUALS(a.nx, 3);
+            TS_ASSERT_EQUALS(a.ng, 5);
+            TS_ASSERT_EQUALS(a.linear, 1);
+            TS_ASSERT_EQUALS(a.quadratic, 3);
+            TS_ASSERT_EQUALS(a.nonlinear, 2);
+            TS_ASSERT_EQUALS(a.custom, 0);
+            TS_ASSERT_EQUALS(a.objective_degree, 2);
+            // x*y and y*z
+            TS_ASSERT_EQUALS(a.identical, 1);
+            TS_ASSERT_EQUALS(a.shapes, 5);
+            TS_ASSERT_EQUALS(a.opcodes["sin"], 1);
+            TS_ASSERT_EQUALS(a.opcodes["sqr"], 2);
+            TS_ASSERT_EQUALS(a.opcodes["ipow"], 1);
+            TS_ASSERT_EQUALS(a.opcodes.count("pow"), 0);
+            TS_ASSERT_EQUALS(a.opcodes["var"], 12);
+            TS_ASSERT_EQUALS(a.opcodes.count("cos"), 0);
+
+            TS_ASSERT_EQUALS(a.nnz_jac, m.getNNZ_Jac());
+            TS_ASSERT_EQUALS(a.nnz_hess, m.getNNZ_Hess());
+            TS_ASSERT_DELTA(a.hess_density, m.getNNZ_Hess()/6., 1e-12);
+            TS_ASSERT_EQUALS(a.jac_row.min, 2);
+            TS_ASSERT_EQUALS(a.jac_row.max, 2);
+            TS_ASSERT_EQUALS(a.jac_row.mean, 2);
+            TS_ASSERT_EQUALS(a.jac_row.histogram, vector<Idx>({0, 0, 6}));
+            // x is in 5 rows, y in 4 and z in 3
+            TS_ASSERT_EQUALS(a.jac_col.min, 3);
+            TS_ASSERT_EQUALS(a.jac_col.max, 5);
+            TS_ASSERT_EQUALS(a.jac_col.histogram, vector<Idx>({0, 0, 1, 2}));
+            TS_ASSERT_EQUALS(a.tape_depth.min, 2);
+            TS_ASSERT_EQUALS(a.tape_depth.max, 3);
+        }
+
+        void testTimeline(){
+            const char* path = "model_tests.trace.json";
+            TestModel m;
+            m.symbolic_threads = 2;
+            Idx N = 1000;
+            vector<Var> x(N);
+            for (Idx i=0; i<N; i++)
+                x[i] = m.addVar(-1, 1, 0.5, "");
+            m.addConstrs(N-1, [&](const Idx& i, double& lb, double& ub){
+                    lb = 0;
+                    ub = 1;
+                    return x[i]*x[i+1];
+                });
+            m.setObj(x[0]*x[1]);
+
+            Timeline::start();
+            m.finalizeConstraints();
+            vector<double> xx(N, 0.3), g(m.ng());
+            m.eval_g(xx.data(), true, g.data());
+            Timeline::stop();
+            // not recorded
+            m.eval_g(xx.data(), true, g.data());
+            // finalizeConstraints, two workers, mapHess and evalConstraints
+            TS_ASSERT_EQUALS(Timeline::size(), 5);
+
+            Timeline::write(path);
+            std::ifstream in(path);
+            std::stringstream content;
+            content << in.rdbuf();
+            std::remove(path);
+            const string trace = content.str();
+            auto count = [&](const string& s){
+                Idx n = 0;
+                for (size_t pos=trace.find(s); pos!=string::npos;
+                        pos=trace.find(s, pos+1))
+                    n++;
+                return n;
+            };
+            TS_ASSERT_EQUALS(trace.find("{\"displayTimeUnit\""), 0);
+            TS_ASSERT_EQUALS(count("\"name\": \"finalizeConstraints\", \"ph\": \"X\""), 1);
+            TS_ASSERT_EQUALS(count("\"name\": \"analyze\", \"ph\": \"X\""), 2);
+            // the workers and the calling thread
+            TS_ASSERT_EQUALS(count("\"name\": \"thread_name\""), 3);
+            TS_ASSERT(trace.find("\"name\": \"evalConstraints\"") != string::npos);
+
+            // the ring buffer keeps the latest spans
+            Timeline::start(2);
+            for (Idx i=0; i<5; i++)
+                m.eval_g(xx.data(), true, g.data());
+            Timeline::stop();
+            TS_ASSERT_EQUALS(Timeline::size(), 2);
+
+            // scopes open across a restart are dropped, whether they end
+            // before or after their begin offset in the new recording
+            Timeline::start();
+            while (Timeline::now() < 10000000);
+            {
+                TIMELINE_SCOPE("restarted");
+                Timeline::start();
+            }
+            TS_ASSERT_EQUALS(Timeline::size(), 0);
+            Timeline::start();
+            while (Timeline::now() < 1000000);
+            {
+                TIMELINE_SCOPE("restarted");
+                Timeline::start();
+                while (Timeline::now() < 2000000);
+            }
+            TS_ASSERT_EQUALS(Timeline::size(), 0);
+            {
+                TIMELINE_SCOPE("kept");
+            }
+            TS_ASSERT_EQUALS(Timeline::size(), 1);
+
+            // restarts while other threads record
+            std::atomic<bool> done(false);
+            vector<std::thread> threads;
+            for (Idx i=0; i<4; i++)
+                threads.emplace_back([&](){
+                        while (not done)
+                            TIMELINE_SCOPE("spin");
+                    });
+            for (Idx i=0; i<100; i++)
+                Timeline::start(16);
+            done = true;
+            for (auto& thread: threads)
+                thread.join();
+            Timeline::stop();
+            TS_ASSERT(Timeline::size() <= 4*16);
+
+            TS_ASSERT_THROWS(Timeline::start(0), MadOptError);
+            TS_ASSERT_THROWS(Timeline::write("/nonexistent/trace.json"), MadOptError);
+        }
 };
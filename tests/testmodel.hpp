@@ -16,6 +16,7 @@
 #ifndef MADOPT_TESTMODEL_H
 #define MADOPT_TESTMODEL_H
 
+#include <cxxtest/TestSuite.h>
 #include "../src/model.hpp"
 using namespace MadOpt;
 
@@ -26,4 +27,87 @@ class TestModel: public Model {
         void solve(){}
 };
 
+/*! \brief adds the chain model of the evaluation tests to m
+ * \details variables x_i in [-1.5, 0] starting at -0.5, the objective
+ * sum (x_i - 1)^2*x_{i+1} and the N-2 constraints sin(x_{i+1})*x_{i+2} = x_i
+ * @param[in] m empty model
+ * @param[in] N number of variables, at least 3
+ * @return the variables
+ */
+inline vector<Var> buildChain(Model& m, const Idx& N){
+    vector<Var> x(N);
+    for (Idx i=0; i<N; i++)
+        x[i] = m.addVar(-1.5, 0, -0.5, "x" + std::to_string(i));
+    Expr obj(0);
+    for (Idx i=0; i<N; i++)
+        obj += pow(x[i] - 1, 2) * x[(i+1)%N];
+    m.setObj(obj);
+    for (Idx i=0; i<N-2; i++)
+        m.addEqConstr(sin(x[i+1])*x[i+2] - x[i], 0);
+    return x;
+}
+
+//! asserts that all values differ by at most delta
+inline void assertValues(const vector<double>& values,
+        const vector<double>& expected, const double& delta){
+    TS_ASSERT_EQUALS(values.size(), expected.size());
+    if (delta == 0){
+        TS_ASSERT_EQUALS(values, expected);
+    } else {
+        for (Idx i=0; i<values.size() and i<expected.size(); i++)
+            TS_ASSERT_DELTA(values[i], expected[i], delta);
+    }
+}
+
+/*! \brief compares the sparsity structures of m and ref and the results of
+ * all evaluation callbacks at x
+ * \details m runs the callbacks in the order of a solver, ref in the reverse
+ * order, both start with new_x
+ * @param[in] delta 0 requires identical results
+ */
+inline void compareEvals(Model& m, Model& ref, const double* x,
+        const double* lambda, const double& delta=0){
+    TS_ASSERT_EQUALS(m.nx(), ref.nx());
+    TS_ASSERT_EQUALS(m.ng(), ref.ng());
+    Idx njac = m.getNNZ_Jac();
+    Idx nhess = m.getNNZ_Hess();
+    TS_ASSERT_EQUALS(njac, ref.getNNZ_Jac());
+    TS_ASSERT_EQUALS(nhess, ref.getNNZ_Hess());
+    if (njac != ref.getNNZ_Jac() or nhess != ref.getNNZ_Hess())
+        return;
+
+    vector<int> rows(njac), cols(njac), rows_ref(njac), cols_ref(njac);
+    m.getNZ_Jac(rows.data(), cols.data());
+    ref.getNZ_Jac(rows_ref.data(), cols_ref.data());
+    TS_ASSERT_EQUALS(rows, rows_ref);
+    TS_ASSERT_EQUALS(cols, cols_ref);
+    rows.resize(nhess); cols.resize(nhess);
+    rows_ref.resize(nhess); cols_ref.resize(nhess);
+    m.getNZ_Hess(rows.data(), cols.data());
+    ref.getNZ_Hess(rows_ref.data(), cols_ref.data());
+    TS_ASSERT_EQUALS(rows, rows_ref);
+    TS_ASSERT_EQUALS(cols, cols_ref);
+
+    vector<double> f(1), grad(m.nx()), g(m.ng()), jac(njac), hess(nhess);
+    m.eval_f(x, true, f[0]);
+    m.eval_grad_f(x, false, grad.data());
+    m.eval_g(x, false, g.data());
+    m.eval_jac_g(x, false, jac.data());
+    m.eval_h(x, false, hess.data(), 1, lambda);
+
+    vector<double> f_ref(1), grad_ref(m.nx()), g_ref(m.ng());
+    vector<double> jac_ref(njac), hess_ref(nhess);
+    ref.eval_h(x, true, hess_ref.data(), 1, lambda);
+    ref.eval_jac_g(x, false, jac_ref.data());
+    ref.eval_g(x, false, g_ref.data());
+    ref.eval_grad_f(x, false, grad_ref.data());
+    ref.eval_f(x, false, f_ref[0]);
+
+    assertValues(f, f_ref, delta);
+    assertValues(grad, grad_ref, delta);
+    assertValues(g, g_ref, delta);
+    assertValues(jac, jac_ref, delta);
+    assertValues(hess, hess_ref, delta);
+}
+
 #endif